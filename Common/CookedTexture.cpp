@@ -0,0 +1,239 @@
+#include "CookedTexture.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sys/stat.h>
+
+#ifndef _WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static const char COOKED_MAGIC[4] = { 'C', 'T', 'X', '2' };
+static const char COOKED_EXTENSION[] = ".ctex";
+static const uint32_t LEVEL_ALIGNMENT = 16;
+
+// Reads the whole source file to get its size and hash. The PNGs are small enough next to
+// the pixels they decode to that this costs far less than the decoding it saves
+static bool get_source_fingerprint(const char *source_filepath, uint32_t &size, uint64_t &hash)
+{
+    std::ifstream file(source_filepath, std::ios::binary);
+    if (file.fail()) return false;
+    
+    size = 0;
+    hash = 14695981039346656037ull;
+    
+    char buffer[64 * 1024];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+    {
+        for (std::streamsize i = 0; i < file.gcount(); i++)
+        {
+            hash ^= (unsigned char) buffer[i];
+            hash *= 1099511628211ull;
+        }
+        size += (uint32_t) file.gcount();
+    }
+    
+    return !file.bad();
+}
+
+std::string CookedTexture::get_cooked_path(const char *source_filepath)
+{
+    std::string path = source_filepath;
+    size_t dot   = path.find_last_of('.');
+    size_t slash = path.find_last_of('/');
+    
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) path.erase(dot);
+    return path + COOKED_EXTENSION;
+}
+
+bool CookedTexture::open(const char *source_filepath)
+{
+    close();
+    
+    std::string cooked_path = get_cooked_path(source_filepath);
+    
+    struct stat cooked_info;
+    if (stat(cooked_path.c_str(), &cooked_info) != 0) return false;
+    
+#ifdef _WINDOWS
+    std::ifstream file(cooked_path.c_str(), std::ios::binary);
+    if (file.fail()) return false;
+    
+    m_buffer.resize(cooked_info.st_size);
+    if (!file.read((char *) m_buffer.data(), m_buffer.size())) return false;
+    
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+#else
+    int file = ::open(cooked_path.c_str(), O_RDONLY);
+    if (file == -1) return false;
+    
+    // Mapping the file means no copy on our side: the pages go straight from the page cache to GL
+    void *data = cooked_info.st_size > 0 ? mmap(NULL, cooked_info.st_size, PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    ::close(file);
+    if (data == MAP_FAILED) return false;
+    
+    m_data = (const unsigned char *) data;
+    m_size = cooked_info.st_size;
+#endif
+    
+    m_header = (const Header *) m_data;
+    m_levels = (const Level  *) (m_data + sizeof(Header));
+    
+    if (!validate())
+    {
+        close();
+        return false;
+    }
+    
+    // Someone has edited the image since it was cooked, so the cooked copy is out of date. If the
+    // source can't be read at all, the cooked copy is all we have
+    uint32_t source_size;
+    uint64_t source_hash;
+    if (get_source_fingerprint(source_filepath, source_size, source_hash) &&
+        (source_size != m_header->source_size || source_hash != m_header->source_hash))
+    {
+        close();
+        return false;
+    }
+    
+    return true;
+}
+
+bool CookedTexture::validate() const
+{
+    if (m_size < sizeof(Header)) return false;
+    if (memcmp(m_header->magic, COOKED_MAGIC, sizeof(COOKED_MAGIC)) != 0) return false;
+    if (m_header->format != FORMAT_RGBA8) return false;
+    if (m_header->level_count == 0 || m_header->level_count > MAX_LEVELS) return false;
+    if (m_header->width == 0 || m_header->height == 0) return false;
+    if (m_size < sizeof(Header) + m_header->level_count * sizeof(Level)) return false;
+    
+    // Every level has to be the size the header says, halved once per level, and be where the
+    // table says with exactly that many pixels. Sizes are worked out in 64 bits, so a made-up
+    // width and height can't wrap around to a small number that happens to match
+    uint32_t width  = m_header->width,
+             height = m_header->height;
+    
+    for (int i = 0; i < m_header->level_count; i++)
+    {
+        const Level &level = m_levels[i];
+        if (level.width != width || level.height != height) return false;
+        if ((uint64_t) level.size != (uint64_t) width * height * 4) return false;
+        if ((uint64_t) level.offset + level.size > m_size) return false;
+        
+        width  = std::max(width  / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    
+    return true;
+}
+
+void CookedTexture::close()
+{
+#ifdef _WINDOWS
+    std::vector<unsigned char>().swap(m_buffer);
+#else
+    if (m_data != NULL) munmap((void *) m_data, m_size);
+#endif
+    
+    m_data   = NULL;
+    m_size   = 0;
+    m_header = NULL;
+    m_levels = NULL;
+}
+
+// Halves an RGBA image. Colours are weighted by alpha, so the invisible (and usually black)
+// pixels around a sprite don't darken its edges as it gets smaller
+static void build_next_level(const std::vector<unsigned char> &source, int source_width, int source_height,
+                             std::vector<unsigned char> &level, int width, int height)
+{
+    level.resize(width * height * 4);
+    
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            unsigned int red = 0, green = 0, blue = 0, alpha = 0, count = 0;
+            
+            // A side that's already 1 pixel long has nothing to halve
+            for (int sample_y = y * 2; sample_y < std::min(y * 2 + 2, source_height); sample_y++)
+            {
+                for (int sample_x = x * 2; sample_x < std::min(x * 2 + 2, source_width); sample_x++)
+                {
+                    const unsigned char *pixel = &source[(sample_y * source_width + sample_x) * 4];
+                    red   += pixel[0] * pixel[3];
+                    green += pixel[1] * pixel[3];
+                    blue  += pixel[2] * pixel[3];
+                    alpha += pixel[3];
+                    count++;
+                }
+            }
+            
+            unsigned char *pixel = &level[(y * width + x) * 4];
+            pixel[0] = alpha > 0 ? (red   + alpha / 2) / alpha : 0;
+            pixel[1] = alpha > 0 ? (green + alpha / 2) / alpha : 0;
+            pixel[2] = alpha > 0 ? (blue  + alpha / 2) / alpha : 0;
+            pixel[3] = (alpha + count / 2) / count;
+        }
+    }
+}
+
+bool CookedTexture::cook(const char *source_filepath, const unsigned char *pixels, int width, int height, bool mipmaps)
+{
+    std::vector<std::vector<unsigned char> > levels(1);
+    std::vector<Level> table(1);
+    
+    levels[0].assign(pixels, pixels + width * height * 4);
+    table[0].width  = width;
+    table[0].height = height;
+    
+    // Down to 1x1, the way GL counts a full mip chain
+    while (mipmaps && (table.back().width > 1 || table.back().height > 1) && table.size() < MAX_LEVELS)
+    {
+        Level next;
+        next.width  = std::max(table.back().width  / 2, 1u);
+        next.height = std::max(table.back().height / 2, 1u);
+        
+        levels.push_back(std::vector<unsigned char>());
+        build_next_level(levels[levels.size() - 2], table.back().width, table.back().height,
+                         levels.back(), next.width, next.height);
+        table.push_back(next);
+    }
+    
+    Header header;
+    memcpy(header.magic, COOKED_MAGIC, sizeof(COOKED_MAGIC));
+    header.format      = FORMAT_RGBA8;
+    header.width       = width;
+    header.height      = height;
+    header.level_count = (uint32_t) table.size();
+    if (!get_source_fingerprint(source_filepath, header.source_size, header.source_hash)) return false;
+    
+    uint32_t offset = sizeof(Header) + table.size() * sizeof(Level);
+    for (int i = 0; i < table.size(); i++)
+    {
+        offset = (offset + LEVEL_ALIGNMENT - 1) / LEVEL_ALIGNMENT * LEVEL_ALIGNMENT;
+        table[i].offset = offset;
+        table[i].size   = (uint32_t) levels[i].size();
+        offset += table[i].size;
+    }
+    
+    std::string cooked_path = get_cooked_path(source_filepath);
+    std::ofstream file(cooked_path.c_str(), std::ios::binary);
+    if (file.fail()) return false;
+    
+    file.write((const char *) &header, sizeof(Header));
+    file.write((const char *) table.data(), table.size() * sizeof(Level));
+    
+    for (int i = 0; i < table.size(); i++)
+    {
+        static const char padding[LEVEL_ALIGNMENT] = { 0 };
+        file.write(padding, table[i].offset - (uint32_t) file.tellp());
+        file.write((const char *) levels[i].data(), levels[i].size());
+    }
+    
+    return file.good();
+}
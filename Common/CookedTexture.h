@@ -0,0 +1,78 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// A texture cooked ahead of time by tools/cook_textures.cpp, so loading it needs no PNG
+// decoding: the pixels are already RGBA, with every mip level worked out. The file is
+// memory-mapped and each level goes straight to glTexImage2D.
+//
+// "bear.png" cooks to "bear.ctex" next to it. The layout is a Header, then a Level for each
+// mip level (largest first), then the levels' pixels, each starting on a 16-byte boundary.
+// The header remembers the size and a hash of the PNG it came from, so an edited image is
+// noticed even when a checkout or copy has changed every file's modification time
+class CookedTexture {
+public:
+    struct Header
+    {
+        char     magic[4];
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t level_count;
+        uint32_t source_size;
+        uint64_t source_hash;  // FNV-1a over the source file's bytes
+    };
+    
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        uint32_t offset;  // From the start of the file
+        uint32_t size;
+    };
+    
+    static const uint32_t FORMAT_RGBA8 = 0;
+    static const int      MAX_LEVELS   = 16;
+    
+private:
+    const unsigned char *m_data = NULL;
+    size_t m_size = 0;
+    
+#ifdef _WINDOWS
+    std::vector<unsigned char> m_buffer;  // No mmap here, so we read the file in instead
+#endif
+    
+    const Header *m_header = NULL;
+    const Level  *m_levels = NULL;
+    
+    bool validate() const;
+    
+public:
+    ~CookedTexture() { close(); }
+    
+    // Methods
+    // Opens the cooked copy of source_filepath. False if there isn't one, it was cooked from
+    // different bytes than the source has now, or it isn't a file we understand; in every case,
+    // load the source instead
+    bool open(const char *source_filepath);
+    void close();
+    
+    // Builds the mip chain for pixels (RGBA, rows top to bottom) and writes it all out. Without
+    // mipmaps only the full-size level is written, for loaders like TextureAtlas that never use the rest
+    static bool cook(const char *source_filepath, const unsigned char *pixels, int width, int height, bool mipmaps = true);
+    static std::string get_cooked_path(const char *source_filepath);
+    
+    // Getters
+    int                  const get_level_count()     const { return m_header->level_count;       }
+    Level                const get_level(int level)  const { return m_levels[level];             }
+    const unsigned char *const get_pixels(int level) const { return m_data + m_levels[level].offset; }
+};
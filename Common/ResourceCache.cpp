@@ -0,0 +1,104 @@
+#include "ResourceCache.h"
+#include <cassert>
+#include <iostream>
+#include "stb_image.h"
+
+#define LOG(argument) std::cout << argument << '\n'
+
+const int NUMBER_OF_TEXTURES = 1;
+const GLint LEVEL_OF_DETAIL  = 0;
+const GLint TEXTURE_BORDER   = 0;
+
+GLuint ResourceCache::acquire_texture(const char *filepath)
+{
+    std::map<std::string, TextureEntry>::iterator entry = m_textures.find(filepath);
+    
+    // Already loaded, so there's nothing to do
+    if (entry != m_textures.end())
+    {
+        m_hits++;
+        return entry->second.texture_id;
+    }
+    
+    TextureEntry new_entry;
+    new_entry.texture_id = load_texture(filepath, &new_entry.bytes);
+    
+    m_textures[filepath] = new_entry;
+    m_bytes += new_entry.bytes;
+    m_misses++;
+    
+    return new_entry.texture_id;
+}
+
+void ResourceCache::cleanup()
+{
+    for (std::map<std::string, TextureEntry>::iterator entry = m_textures.begin(); entry != m_textures.end(); entry++)
+    {
+        glDeleteTextures(NUMBER_OF_TEXTURES, &entry->second.texture_id);
+    }
+    
+    m_textures.clear();
+    m_bytes = 0;
+}
+
+GLuint ResourceCache::load_texture(const char *filepath, size_t *bytes)
+{
+    // A cooked copy (see CookedTexture.h) skips the decoding below, and brings mipmaps with it
+    CookedTexture cooked;
+    if (cooked.open(filepath)) return load_cooked_texture(cooked, bytes);
+    
+    // STEP 1: Loading the image file
+    int width, height, number_of_components;
+    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+    
+    if (image == NULL)
+    {
+        LOG("Unable to load image. Make sure the path is correct.");
+        LOG(filepath);
+        assert(false);
+    }
+    
+    // STEP 2: Generating and binding a texture ID to our image
+    GLuint texture_id;
+    glGenTextures(NUMBER_OF_TEXTURES, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    
+    // STEP 3: Setting our texture filter parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    
+    // STEP 4: Releasing our file from memory and returning our texture id
+    stbi_image_free(image);
+    
+    *bytes = (size_t) width * height * 4;
+    return texture_id;
+}
+
+GLuint ResourceCache::load_cooked_texture(const CookedTexture &cooked, size_t *bytes)
+{
+    GLuint texture_id;
+    glGenTextures(NUMBER_OF_TEXTURES, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    
+    // The pixels are ready to go, straight out of the mapped file
+    *bytes = 0;
+    for (int level = 0; level < cooked.get_level_count(); level++)
+    {
+        CookedTexture::Level info = cooked.get_level(level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, info.width, info.height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, cooked.get_pixels(level));
+        *bytes += info.size;
+    }
+    
+    // Still nearest-neighbour, so the sprites stay crisp, but a sprite drawn smaller than its
+    // image now samples the level closest to its size instead of skipping over texels
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, cooked.get_level_count() - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, cooked.get_level_count() > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    
+    return texture_id;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <map>
+#include <string>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "CookedTexture.h"
+
+// Loads each image once and hands the same texture back to everyone who asks for it. Shared
+// by the projects that load their textures one file at a time (project 1 and SDLProject).
+// Their textures are all loaded at start-up and used until the game quits, so nothing is
+// released on its own: cleanup() deletes the lot at shutdown
+class ResourceCache {
+private:
+    struct TextureEntry
+    {
+        GLuint texture_id;
+        size_t bytes;
+    };
+    
+    // Keyed by file path, so asking for the same image twice hands back the same texture
+    std::map<std::string, TextureEntry> m_textures;
+    
+    int    m_hits   = 0;
+    int    m_misses = 0;
+    size_t m_bytes  = 0;
+    
+    GLuint load_texture(const char *filepath, size_t *bytes);
+    GLuint load_cooked_texture(const CookedTexture &cooked, size_t *bytes);
+    
+public:
+    // Methods
+    GLuint acquire_texture(const char *filepath);
+    void   cleanup();
+    
+    // Getters
+    int    const get_hits()          const { return m_hits;                   }
+    int    const get_misses()        const { return m_misses;                 }
+    size_t const get_bytes()         const { return m_bytes;                  }
+    int    const get_texture_count() const { return (int) m_textures.size(); }
+};
@@ -0,0 +1,227 @@
+#include "HeadlessTarget.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+// Framebuffer objects are core from GL 3.0, and an extension before that (the macOS legacy
+// context only has the EXT one). The constants are the same either way
+#ifndef GL_FRAMEBUFFER
+#define GL_FRAMEBUFFER 0x8D40
+#endif
+#ifndef GL_RENDERBUFFER
+#define GL_RENDERBUFFER 0x8D41
+#endif
+#ifndef GL_COLOR_ATTACHMENT0
+#define GL_COLOR_ATTACHMENT0 0x8CE0
+#endif
+#ifndef GL_FRAMEBUFFER_COMPLETE
+#define GL_FRAMEBUFFER_COMPLETE 0x8CD5
+#endif
+
+typedef void   (*GenFramebuffersFunction)(GLsizei n, GLuint *framebuffers);
+typedef void   (*BindFramebufferFunction)(GLenum target, GLuint framebuffer);
+typedef void   (*DeleteFramebuffersFunction)(GLsizei n, const GLuint *framebuffers);
+typedef void   (*GenRenderbuffersFunction)(GLsizei n, GLuint *renderbuffers);
+typedef void   (*BindRenderbufferFunction)(GLenum target, GLuint renderbuffer);
+typedef void   (*DeleteRenderbuffersFunction)(GLsizei n, const GLuint *renderbuffers);
+typedef void   (*RenderbufferStorageFunction)(GLenum target, GLenum internal_format, GLsizei width, GLsizei height);
+typedef void   (*FramebufferRenderbufferFunction)(GLenum target, GLenum attachment, GLenum renderbuffer_target, GLuint renderbuffer);
+typedef GLenum (*CheckFramebufferStatusFunction)(GLenum target);
+
+static GenFramebuffersFunction         gen_framebuffers          = NULL;
+static BindFramebufferFunction         bind_framebuffer          = NULL;
+static DeleteFramebuffersFunction      delete_framebuffers       = NULL;
+static GenRenderbuffersFunction        gen_renderbuffers         = NULL;
+static BindRenderbufferFunction        bind_renderbuffer         = NULL;
+static DeleteRenderbuffersFunction     delete_renderbuffers      = NULL;
+static RenderbufferStorageFunction     renderbuffer_storage      = NULL;
+static FramebufferRenderbufferFunction framebuffer_renderbuffer  = NULL;
+static CheckFramebufferStatusFunction  check_framebuffer_status  = NULL;
+
+static void *get_framebuffer_function(const char *name, const char *suffix)
+{
+    return SDL_GL_GetProcAddress((std::string(name) + suffix).c_str());
+}
+
+void HeadlessTarget::parse_arguments(int argc, char* argv[])
+{
+    for (int i = 1; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            m_is_enabled  = true;
+            m_frame_limit = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--dump") == 0)
+        {
+            std::stringstream frames(argv[++i]);
+            std::string frame;
+            while (std::getline(frames, frame, ',')) m_dump_frames.insert(atoi(frame.c_str()));
+        }
+        else if (strcmp(argv[i], "--dump-dir") == 0) m_dump_directory   = argv[++i];
+        else if (strcmp(argv[i], "--timings")  == 0) m_timings_filepath = argv[++i];
+    }
+    
+    if (!m_is_enabled) return;
+    
+#ifdef __linux__
+    // SDL's offscreen driver gives us a GL context on an EGL pbuffer (llvmpipe will do), no
+    // display server needed. Setting SDL_VIDEODRIVER yourself still wins over this
+    SDL_setenv("SDL_VIDEODRIVER", "offscreen", 0);
+#endif
+}
+
+void HeadlessTarget::initialise(int width, int height)
+{
+    if (!m_is_enabled) return;
+    
+    m_width  = width;
+    m_height = height;
+    m_frame_times.reserve(m_frame_limit);
+    
+    const char *suffix = NULL;
+    if      (SDL_GL_ExtensionSupported("GL_ARB_framebuffer_object")) suffix = "";
+    else if (SDL_GL_ExtensionSupported("GL_EXT_framebuffer_object")) suffix = "EXT";
+    
+    if (suffix != NULL)
+    {
+        gen_framebuffers         = (GenFramebuffersFunction)         get_framebuffer_function("glGenFramebuffers",         suffix);
+        bind_framebuffer         = (BindFramebufferFunction)         get_framebuffer_function("glBindFramebuffer",         suffix);
+        delete_framebuffers      = (DeleteFramebuffersFunction)      get_framebuffer_function("glDeleteFramebuffers",      suffix);
+        gen_renderbuffers        = (GenRenderbuffersFunction)        get_framebuffer_function("glGenRenderbuffers",        suffix);
+        bind_renderbuffer        = (BindRenderbufferFunction)        get_framebuffer_function("glBindRenderbuffer",        suffix);
+        delete_renderbuffers     = (DeleteRenderbuffersFunction)     get_framebuffer_function("glDeleteRenderbuffers",     suffix);
+        renderbuffer_storage     = (RenderbufferStorageFunction)     get_framebuffer_function("glRenderbufferStorage",     suffix);
+        framebuffer_renderbuffer = (FramebufferRenderbufferFunction) get_framebuffer_function("glFramebufferRenderbuffer", suffix);
+        check_framebuffer_status = (CheckFramebufferStatusFunction)  get_framebuffer_function("glCheckFramebufferStatus",  suffix);
+    }
+    
+    bool has_functions = gen_framebuffers && bind_framebuffer && delete_framebuffers &&
+                         gen_renderbuffers && bind_renderbuffer && delete_renderbuffers &&
+                         renderbuffer_storage && framebuffer_renderbuffer && check_framebuffer_status;
+    
+    if (has_functions)
+    {
+        gen_renderbuffers(1, &m_renderbuffer);
+        bind_renderbuffer(GL_RENDERBUFFER, m_renderbuffer);
+        renderbuffer_storage(GL_RENDERBUFFER, GL_RGBA8, m_width, m_height);
+        bind_renderbuffer(GL_RENDERBUFFER, 0);
+        
+        gen_framebuffers(1, &m_framebuffer);
+        bind_framebuffer(GL_FRAMEBUFFER, m_framebuffer);
+        framebuffer_renderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_renderbuffer);
+        
+        if (check_framebuffer_status(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            LOG("Offscreen framebuffer is incomplete");
+            bind_framebuffer(GL_FRAMEBUFFER, 0);
+            delete_framebuffers(1, &m_framebuffer);
+            delete_renderbuffers(1, &m_renderbuffer);
+            m_framebuffer  = 0;
+            m_renderbuffer = 0;
+        }
+    }
+    
+    // Without a framebuffer of our own, the pbuffer behind the hidden window is still there to draw into
+    if (m_framebuffer == 0) LOG("No framebuffer objects; drawing headless frames into the default framebuffer");
+    
+    m_frame_start = SDL_GetPerformanceCounter();
+}
+
+void HeadlessTarget::end_frame()
+{
+    if (!m_is_enabled) return;
+    
+    // GL queues work up; without waiting here we'd only be timing how fast we can queue it
+    glFinish();
+    
+    Uint64 frame_end = SDL_GetPerformanceCounter();
+    m_frame_times.push_back((frame_end - m_frame_start) * 1000.0 / SDL_GetPerformanceFrequency());
+    m_frame_count++;
+    
+    // The dump is written outside the timed part, so it doesn't skew the numbers
+    if (m_dump_frames.count(m_frame_count) > 0) dump_frame(m_frame_count);
+    
+    m_frame_start = SDL_GetPerformanceCounter();
+}
+
+void HeadlessTarget::dump_frame(int frame) const
+{
+    std::vector<unsigned char> pixels(m_width * m_height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    
+    char filename[32];
+    snprintf(filename, sizeof(filename), "frame_%d.ppm", frame);
+    std::string filepath = m_dump_directory + "/" + filename;
+    
+    std::ofstream file(filepath.c_str(), std::ios::binary);
+    if (file.fail())
+    {
+        LOG("Can't write " << filepath);
+        return;
+    }
+    
+    // PPM is about as simple as an image file gets: a short text header, then RGB rows from the
+    // top down. GL hands rows back from the bottom up, so we flip them on the way out
+    file << "P6\n" << m_width << " " << m_height << "\n255\n";
+    
+    std::vector<unsigned char> row(m_width * 3);
+    for (int y = m_height - 1; y >= 0; y--)
+    {
+        for (int x = 0; x < m_width; x++)
+        {
+            memcpy(&row[x * 3], &pixels[(y * m_width + x) * 4], 3);
+        }
+        file.write((const char *) row.data(), row.size());
+    }
+    
+    LOG("Wrote " << filepath);
+}
+
+void HeadlessTarget::report() const
+{
+    if (m_frame_times.empty()) return;
+    
+    std::vector<double> sorted_times = m_frame_times;
+    std::sort(sorted_times.begin(), sorted_times.end());
+    
+    double total = 0.0;
+    for (int i = 0; i < sorted_times.size(); i++) total += sorted_times[i];
+    
+    int count = (int) sorted_times.size();
+    double mean = total / count;
+    
+    LOG("Headless: " << count << " frames at " << m_width << "x" << m_height << " in " << total << " ms (" << 1000.0 / mean << " fps)");
+    LOG("  mean " << mean << " ms, min " << sorted_times.front() << " ms, max " << sorted_times.back() << " ms");
+    LOG("  p50 " << sorted_times[count / 2] << " ms, p95 " << sorted_times[count * 95 / 100] << " ms, p99 " << sorted_times[count * 99 / 100] << " ms");
+    
+    if (m_timings_filepath.empty()) return;
+    
+    std::ofstream file(m_timings_filepath.c_str());
+    for (int i = 0; i < m_frame_times.size(); i++) file << m_frame_times[i] << '\n';
+}
+
+void HeadlessTarget::cleanup()
+{
+    if (!m_is_enabled) return;
+    
+    report();
+    m_frame_times.clear();
+    
+    if (m_framebuffer != 0)
+    {
+        bind_framebuffer(GL_FRAMEBUFFER, 0);
+        delete_framebuffers(1, &m_framebuffer);
+        delete_renderbuffers(1, &m_renderbuffer);
+    }
+    
+    m_framebuffer  = 0;
+    m_renderbuffer = 0;
+}
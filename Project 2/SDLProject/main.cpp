@@ -11,6 +11,7 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "HeadlessTarget.h"
 #include "stb_image.h"
 #include "cmath"
 #include <ctime>
@@ -35,7 +36,7 @@ const int VIEWPORT_X = 0,
           VIEWPORT_WIDTH  = WINDOW_WIDTH,
           VIEWPORT_HEIGHT = WINDOW_HEIGHT;
 
-const char V_SHADER_PATH[] = "shaders/vertex.glsl",
+const char V_SHADER_PATH[] = "shaders/vertex_mvp.glsl",
            F_SHADER_PATH[] = "shaders/fragment.glsl";
 
 const float MILLISECONDS_IN_SECOND = 1000.0;
@@ -47,6 +48,7 @@ bool game_is_running = true;
 bool is_growing = true;
 
 ShaderProgram program;
+HeadlessTarget headless;
 glm::mat4 view_matrix, paddle_1, projection_matrix, trans_matrix, paddle_2, ball;
 
 float previous_ticks = 0.0f;
@@ -77,7 +79,7 @@ void initialise()
     display_window = SDL_CreateWindow("Pong Clone",
                                       SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                       WINDOW_WIDTH, WINDOW_HEIGHT,
-                                      SDL_WINDOW_OPENGL);
+                                      SDL_WINDOW_OPENGL | headless.get_window_flags());
     
     SDL_GLContext context = SDL_GL_CreateContext(display_window);
     SDL_GL_MakeCurrent(display_window, context);
@@ -87,6 +89,15 @@ void initialise()
 #endif
     
     glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    headless.initialise(WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    // Linked shaders are saved between launches, so only the first start has to compile them
+    char *pref_path = SDL_GetPrefPath("CS3113", "Project 2");
+    if (pref_path != NULL)
+    {
+        ShaderProgram::cacheDirectory = pref_path;
+        SDL_free(pref_path);
+    }
     
     program.Load(V_SHADER_PATH, F_SHADER_PATH);
     
@@ -105,7 +116,7 @@ void initialise()
     
     program.SetColor(TRIANGLE_RED, TRIANGLE_BLUE, TRIANGLE_GREEN, TRIANGLE_OPACITY);
     
-    glUseProgram(program.programID);
+    program.Use();
     
     glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
     
@@ -247,7 +258,7 @@ bool check_collision(glm::vec3 &position_a, glm::vec3 &position_b)
 
 void update()
 {
-    float ticks = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND; // get the current number of ticks
+    float ticks = (float) headless.get_ticks() / MILLISECONDS_IN_SECOND; // get the current number of ticks
     float delta_time = ticks - previous_ticks; // the delta time is the difference from the last frame
     previous_ticks = ticks;
     
@@ -343,11 +354,16 @@ void render() {
     SDL_GL_SwapWindow(display_window);
 }
 
-void shutdown() { SDL_Quit(); }
+void shutdown()
+{
+    headless.cleanup();
+    SDL_Quit();
+}
 
 
 int main(int argc, char* argv[])
 {
+    headless.parse_arguments(argc, argv);
     initialise();
     
     while (game_is_running)
@@ -355,6 +371,10 @@ int main(int argc, char* argv[])
         process_input();
         update();
         render();
+        
+        // Headless runs stop by themselves once they've drawn the frames they were asked for
+        headless.end_frame();
+        if (headless.is_finished()) game_is_running = false;
     }
     
     shutdown();
@@ -0,0 +1,430 @@
+#include <math.h>
+#include <algorithm>
+#include "AABBTree.h"
+
+// How many steps' worth of its last movement a moving box is stretched by, so a steady walker
+// doesn't have to be refiled every few steps
+const float DISPLACEMENT_MULTIPLIER = 4.0f;
+
+static Bounds combine(const Bounds &a, const Bounds &b)
+{
+    Bounds combined = { std::min(a.left, b.left),   std::min(a.bottom, b.bottom),
+                        std::max(a.right, b.right), std::max(a.top, b.top) };
+    return combined;
+}
+
+// The tree is built to keep this small, the 2D stand-in for a box's surface area
+static float perimeter(const Bounds &bounds)
+{
+    return 2.0f * ((bounds.right - bounds.left) + (bounds.top - bounds.bottom));
+}
+
+static bool contains(const Bounds &outer, const Bounds &inner)
+{
+    return outer.left <= inner.left && outer.bottom <= inner.bottom && inner.right <= outer.right && inner.top <= outer.top;
+}
+
+// Boxes that only touch count, so nothing check_collision might call a hit is left out
+static bool overlaps(const Bounds &a, const Bounds &b)
+{
+    return a.left <= b.right && b.left <= a.right && a.bottom <= b.top && b.bottom <= a.top;
+}
+
+// Where along the segment (start plus fraction times direction) it enters the box, if it does
+// so before max_fraction. Starting inside counts as entering at 0
+static bool segment_enters(const Bounds &bounds, float start_x, float start_y, float direction_x, float direction_y,
+                           float max_fraction, float &entry_fraction)
+{
+    float low  = 0.0f,
+          high = max_fraction;
+    
+    float starts[2]     = { start_x, start_y },
+          directions[2] = { direction_x, direction_y },
+          minimums[2]   = { bounds.left, bounds.bottom },
+          maximums[2]   = { bounds.right, bounds.top };
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        // Running parallel to this axis's sides, so it's either between them the whole way or never
+        if (directions[axis] == 0.0f)
+        {
+            if (starts[axis] < minimums[axis] || starts[axis] > maximums[axis]) return false;
+            continue;
+        }
+    
+        float near = (minimums[axis] - starts[axis]) / directions[axis],
+              far  = (maximums[axis] - starts[axis]) / directions[axis];
+        if (near > far) std::swap(near, far);
+    
+        low  = std::max(low, near);
+        high = std::min(high, far);
+        if (low > high) return false;
+    }
+    
+    entry_fraction = low;
+    return true;
+}
+
+void AABBTree::initialise(float margin)
+{
+    m_margin = margin;
+    clear();
+}
+
+void AABBTree::clear()
+{
+    m_nodes.clear();
+    m_free_nodes.clear();
+    m_root = NULL_NODE;
+    
+    m_leaves.clear();
+    m_bounds.clear();
+    m_is_static.clear();
+    m_dynamic_slots.clear();
+    m_dynamic_slots_changed = false;
+    
+    m_refiled_count = 0;
+}
+
+int AABBTree::allocate_node()
+{
+    int node;
+    if (m_free_nodes.empty())
+    {
+        node = (int) m_nodes.size();
+        m_nodes.push_back(Node());
+    }
+    else
+    {
+        node = m_free_nodes.back();
+        m_free_nodes.pop_back();
+    }
+    
+    m_nodes[node].parent = m_nodes[node].left = m_nodes[node].right = NULL_NODE;
+    m_nodes[node].height = 0;
+    m_nodes[node].slot   = -1;
+    return node;
+}
+
+void AABBTree::free_node(int node)
+{
+    m_free_nodes.push_back(node);
+}
+
+Bounds AABBTree::fatten(const Bounds &bounds, float displacement_x, float displacement_y) const
+{
+    Bounds fat = { bounds.left - m_margin,  bounds.bottom - m_margin,
+                   bounds.right + m_margin, bounds.top + m_margin };
+    
+    // Only stretched on the side it's heading towards; behind it, it won't be going back soon
+    displacement_x *= DISPLACEMENT_MULTIPLIER;
+    displacement_y *= DISPLACEMENT_MULTIPLIER;
+    
+    if (displacement_x < 0.0f) fat.left   += displacement_x;
+    else                       fat.right  += displacement_x;
+    if (displacement_y < 0.0f) fat.bottom += displacement_y;
+    else                       fat.top    += displacement_y;
+    
+    return fat;
+}
+
+void AABBTree::insert_leaf(int leaf)
+{
+    if (m_root == NULL_NODE)
+    {
+        m_root = leaf;
+        m_nodes[leaf].parent = NULL_NODE;
+        return;
+    }
+    
+    // Head down towards whichever child would grow the least by taking the leaf in, and stop
+    // once pairing the leaf with the whole branch here is cheaper than going any further
+    Bounds leaf_bounds = m_nodes[leaf].bounds;
+    int sibling = m_root;
+    
+    while (!m_nodes[sibling].is_leaf())
+    {
+        const Node &node = m_nodes[sibling];
+        float combined_perimeter = perimeter(combine(node.bounds, leaf_bounds));
+    
+        // A new branch here would hold both, and everything above grows either way
+        float cost             = 2.0f * combined_perimeter,
+              inheritance_cost = 2.0f * (combined_perimeter - perimeter(node.bounds));
+    
+        float child_costs[2];
+        int children[2] = { node.left, node.right };
+    
+        for (int i = 0; i < 2; i++)
+        {
+            const Node &child = m_nodes[children[i]];
+            child_costs[i] = perimeter(combine(child.bounds, leaf_bounds)) + inheritance_cost;
+            if (!child.is_leaf()) child_costs[i] -= perimeter(child.bounds);
+        }
+    
+        if (cost < child_costs[0] && cost < child_costs[1]) break;
+        sibling = child_costs[0] < child_costs[1] ? children[0] : children[1];
+    }
+    
+    // The leaf and its new sibling become the children of a new branch in the sibling's place
+    int old_parent = m_nodes[sibling].parent,
+        new_parent = allocate_node();
+    
+    m_nodes[new_parent].parent = old_parent;
+    m_nodes[new_parent].bounds = combine(leaf_bounds, m_nodes[sibling].bounds);
+    m_nodes[new_parent].height = m_nodes[sibling].height + 1;
+    m_nodes[new_parent].left   = sibling;
+    m_nodes[new_parent].right  = leaf;
+    m_nodes[sibling].parent    = new_parent;
+    m_nodes[leaf].parent       = new_parent;
+    
+    if (old_parent == NULL_NODE)                  m_root = new_parent;
+    else if (m_nodes[old_parent].left == sibling) m_nodes[old_parent].left  = new_parent;
+    else                                          m_nodes[old_parent].right = new_parent;
+    
+    // Stopping early can leave the new branch lopsided, so rebalancing starts with it
+    refit(new_parent);
+}
+
+void AABBTree::remove_leaf(int leaf)
+{
+    if (leaf == m_root)
+    {
+        m_root = NULL_NODE;
+        return;
+    }
+    
+    // The leaf's parent branch goes too, and its other child moves up to take its place
+    int parent      = m_nodes[leaf].parent,
+        grandparent = m_nodes[parent].parent,
+        sibling     = m_nodes[parent].left == leaf ? m_nodes[parent].right : m_nodes[parent].left;
+    
+    m_nodes[sibling].parent = grandparent;
+    free_node(parent);
+    
+    if (grandparent == NULL_NODE)
+    {
+        m_root = sibling;
+        return;
+    }
+    
+    if (m_nodes[grandparent].left == parent) m_nodes[grandparent].left  = sibling;
+    else                                     m_nodes[grandparent].right = sibling;
+    
+    refit(grandparent);
+}
+
+// Walks from the given branch up to the root, rebalancing and redoing each box and height
+void AABBTree::refit(int node)
+{
+    while (node != NULL_NODE)
+    {
+        node = balance(node);
+    
+        Node &branch = m_nodes[node];
+        branch.height = 1 + std::max(m_nodes[branch.left].height, m_nodes[branch.right].height);
+        branch.bounds = combine(m_nodes[branch.left].bounds, m_nodes[branch.right].bounds);
+    
+        node = branch.parent;
+    }
+}
+
+// If one side of the branch is more than one taller than the other, rotates the taller child up
+// into the branch's place, handing it the branch and its own shorter child. Returns whichever
+// node is now where the branch was
+int AABBTree::balance(int a)
+{
+    if (m_nodes[a].is_leaf() || m_nodes[a].height < 2) return a;
+    
+    int b = m_nodes[a].left,
+        c = m_nodes[a].right;
+    int difference = m_nodes[c].height - m_nodes[b].height;
+    if (difference >= -1 && difference <= 1) return a;
+    
+    // Both directions are the same rotation mirrored, so work with the taller and shorter child
+    bool right_is_taller = difference > 1;
+    int taller  = right_is_taller ? c : b,
+        shorter = right_is_taller ? b : c;
+    
+    int grandchild_left  = m_nodes[taller].left,
+        grandchild_right = m_nodes[taller].right;
+    
+    // The taller child takes the branch's place under its parent
+    m_nodes[taller].left   = a;
+    m_nodes[taller].parent = m_nodes[a].parent;
+    m_nodes[a].parent      = taller;
+    
+    int parent = m_nodes[taller].parent;
+    if (parent == NULL_NODE)            m_root = taller;
+    else if (m_nodes[parent].left == a) m_nodes[parent].left  = taller;
+    else                                m_nodes[parent].right = taller;
+    
+    // It keeps its taller grandchild and gives the shorter one to the branch
+    int kept  = m_nodes[grandchild_left].height > m_nodes[grandchild_right].height ? grandchild_left  : grandchild_right,
+        given = kept == grandchild_left                                             ? grandchild_right : grandchild_left;
+    
+    m_nodes[taller].right = kept;
+    if (right_is_taller) m_nodes[a].right = given;
+    else                 m_nodes[a].left  = given;
+    m_nodes[given].parent = a;
+    
+    m_nodes[a].bounds      = combine(m_nodes[shorter].bounds, m_nodes[given].bounds);
+    m_nodes[a].height      = 1 + std::max(m_nodes[shorter].height, m_nodes[given].height);
+    m_nodes[taller].bounds = combine(m_nodes[a].bounds, m_nodes[kept].bounds);
+    m_nodes[taller].height = 1 + std::max(m_nodes[a].height, m_nodes[kept].height);
+    
+    return taller;
+}
+
+void AABBTree::set_static(int slot, bool is_static)
+{
+    if (slot >= (int) m_is_static.size()) m_is_static.resize(slot + 1, false);
+    if (m_is_static[slot] == is_static) return;
+    
+    m_is_static[slot] = is_static;
+    m_dynamic_slots_changed = true;
+}
+
+void AABBTree::update(const EntityStore *store)
+{
+    int count = store->get_count();
+    if (count < (int) m_leaves.size())
+    {
+        // Static flags belong to slots that aren't there any more either
+        clear();
+    }
+    
+    m_refiled_count = 0;
+    
+    for (int slot = (int) m_leaves.size(); slot < count; slot++)
+    {
+        Bounds bounds = get_bounds(store, slot);
+    
+        int leaf = allocate_node();
+        m_nodes[leaf].slot   = slot;
+        m_nodes[leaf].bounds = is_static(slot) ? bounds : fatten(bounds, 0.0f, 0.0f);  // A platform will never leave its box
+    
+        m_leaves.push_back(leaf);
+        m_bounds.push_back(bounds);
+        insert_leaf(leaf);
+    
+        m_dynamic_slots_changed = true;
+        m_refiled_count++;
+    }
+    
+    if (m_dynamic_slots_changed)
+    {
+        m_dynamic_slots.clear();
+        for (int slot = 0; slot < count; slot++)
+        {
+            if (!is_static(slot)) m_dynamic_slots.push_back(slot);
+        }
+        m_dynamic_slots_changed = false;
+    }
+    
+    for (size_t i = 0; i < m_dynamic_slots.size(); i++)
+    {
+        int slot = m_dynamic_slots[i],
+            leaf = m_leaves[slot];
+    
+        m_bounds[slot] = get_bounds(store, slot);
+        if (contains(m_nodes[leaf].bounds, m_bounds[slot])) continue;
+    
+        remove_leaf(leaf);
+        m_nodes[leaf].bounds = fatten(m_bounds[slot], store->position_x[slot] - store->previous_x[slot],
+                                                      store->position_y[slot] - store->previous_y[slot]);
+        insert_leaf(leaf);
+        m_refiled_count++;
+    }
+}
+
+void AABBTree::find_pairs(std::vector<CollisionPair> &pairs) const
+{
+    pairs.clear();
+    
+    // Only moving slots go looking, so platforms never pay for one another
+    for (size_t i = 0; i < m_dynamic_slots.size(); i++)
+    {
+        int slot = m_dynamic_slots[i];
+        const Bounds &bounds = m_nodes[m_leaves[slot]].bounds;
+    
+        query(bounds.left, bounds.bottom, bounds.right, bounds.top, m_found);
+    
+        for (size_t j = 0; j < m_found.size(); j++)
+        {
+            int other = m_found[j];
+    
+            // Two moving slots find each other, so only the smaller one reports it
+            if (other == slot || (other < slot && !is_static(other))) continue;
+    
+            CollisionPair pair = { std::min(slot, other), std::max(slot, other) };
+            pairs.push_back(pair);
+        }
+    }
+}
+
+void AABBTree::query(float left, float bottom, float right, float top, std::vector<int> &slots) const
+{
+    slots.clear();
+    if (m_root == NULL_NODE) return;
+    
+    Bounds box = { left, bottom, right, top };
+    
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    
+    while (!m_stack.empty())
+    {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+    
+        if (!overlaps(node.bounds, box)) continue;
+    
+        if (node.is_leaf())
+        {
+            slots.push_back(node.slot);
+            continue;
+        }
+    
+        m_stack.push_back(node.left);
+        m_stack.push_back(node.right);
+    }
+}
+
+int AABBTree::ray_cast(float start_x, float start_y, float end_x, float end_y, int ignored_slot, float &hit_fraction) const
+{
+    float direction_x = end_x - start_x,
+          direction_y = end_y - start_y;
+    
+    int hit_slot = -1;
+    hit_fraction = 1.0f;
+    if (m_root == NULL_NODE) return hit_slot;
+    
+    m_stack.clear();
+    m_stack.push_back(m_root);
+    
+    while (!m_stack.empty())
+    {
+        const Node &node = m_nodes[m_stack.back()];
+        m_stack.pop_back();
+    
+        // Anything the segment reaches after the closest hit so far can't be the closest
+        float entry_fraction;
+        if (!segment_enters(node.bounds, start_x, start_y, direction_x, direction_y, hit_fraction, entry_fraction)) continue;
+    
+        if (!node.is_leaf())
+        {
+            m_stack.push_back(node.left);
+            m_stack.push_back(node.right);
+            continue;
+        }
+    
+        // The leaf's box is fattened, so the hit is decided by the slot's real one
+        if (node.slot == ignored_slot) continue;
+        if (!segment_enters(m_bounds[node.slot], start_x, start_y, direction_x, direction_y, hit_fraction, entry_fraction)) continue;
+    
+        hit_slot     = node.slot;
+        hit_fraction = entry_fraction;
+    }
+    
+    return hit_slot;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include "EntityStore.h"
+#include "Broadphase.h"
+
+// A broadphase that keeps every EntityStore slot's box as a leaf of a balanced binary tree,
+// where each branch holds the box around both of its children. A query only walks down the
+// branches its box touches, so it costs about log(colliders) rather than one check each.
+//
+// Moving slots are filed with a box a little bigger than they are, stretched the way they're
+// heading, and only come out and go back in once they leave it, so most steps update() touches
+// nothing but their boxes. Static slots (platforms) are never looked at again once they're in.
+// The tree keeps itself balanced by rotating a branch's taller child up whenever the two sides
+// differ in height by more than one
+class AABBTree {
+private:
+    static const int NULL_NODE = -1;
+    
+    struct Node
+    {
+        Bounds bounds;  // For a leaf, the fattened box its slot was filed with
+        int parent, left, right;
+        int height;     // Leaves are 0
+        int slot;       // Leaves only
+    
+        bool const is_leaf() const { return left == NULL_NODE; }
+    };
+    
+    float m_margin = 0.1f;
+    
+    // Nodes sit side by side and are handed out from the free list first, like SpatialGrid's cells
+    std::vector<Node> m_nodes;
+    std::vector<int>  m_free_nodes;
+    int m_root = NULL_NODE;
+    
+    std::vector<int>    m_leaves;     // One per slot
+    std::vector<Bounds> m_bounds;     // One per slot, its exact box as of the last update
+    std::vector<bool>   m_is_static;  // One per slot, or fewer; anything past the end moves
+    std::vector<int>    m_dynamic_slots;
+    bool m_dynamic_slots_changed = false;
+    
+    mutable std::vector<int> m_stack;
+    mutable std::vector<int> m_found;
+    
+    int m_refiled_count = 0;
+    
+    int  allocate_node();
+    void free_node(int node);
+    
+    void insert_leaf(int leaf);
+    void remove_leaf(int leaf);
+    void refit(int node);
+    int  balance(int node);
+    
+    Bounds fatten(const Bounds &bounds, float displacement_x, float displacement_y) const;
+    bool const is_static(int slot) const { return slot < (int) m_is_static.size() && m_is_static[slot]; }
+    
+public:
+    // The margin is how far a moving box can go before it has to be refiled
+    void initialise(float margin);
+    void clear();
+    
+    // Static slots keep the box they were filed with and are skipped by update() from then on.
+    // This can be called before the slot's first update; if a static slot does move, flag it as
+    // moving again and the next update() will catch up with it
+    void set_static(int slot, bool is_static);
+    
+    // Brings the tree up to date with where the store's slots are now. New slots are added;
+    // if the store has been cleared, so are we
+    void update(const EntityStore *store);
+    
+    // Every pair of slots whose filed boxes overlap, once each. Two static slots are never paired
+    void find_pairs(std::vector<CollisionPair> &pairs) const;
+    
+    // Every slot whose filed box overlaps the given one, once each
+    void query(float left, float bottom, float right, float top, std::vector<int> &slots) const;
+    
+    // The first slot the segment from start to end passes through, or -1 if it misses everything.
+    // hit_fraction is how far along the segment that happened, from 0 to 1. The ignored slot is
+    // usually whoever is casting, since the segment starts inside their own box
+    int ray_cast(float start_x, float start_y, float end_x, float end_y, int ignored_slot, float &hit_fraction) const;
+    
+    // Getters
+    int const get_refiled_count() const { return m_refiled_count; }  // Slots that left their boxes in the last update
+    int const get_height()        const { return m_root == NULL_NODE ? 0 : m_nodes[m_root].height; }
+};
@@ -0,0 +1,26 @@
+#pragma once
+#include "EntityStore.h"
+
+// Two store slots whose boxes might overlap, smaller slot first. A broadphase only promises
+// that every pair that does overlap is in its list; whether they really touch is still up to
+// Entity::check_collision (which also knows about inactive entities)
+struct CollisionPair
+{
+    int a, b;
+};
+
+// The box around a slot in world space, the same one Entity::check_collision uses
+struct Bounds
+{
+    float left, bottom, right, top;
+};
+
+inline Bounds get_bounds(const EntityStore *store, int slot)
+{
+    float half_width  = store->width[slot]  / 2.0f,
+          half_height = store->height[slot] / 2.0f;
+    
+    Bounds bounds = { store->position_x[slot] - half_width,  store->position_y[slot] - half_height,
+                      store->position_x[slot] + half_width,  store->position_y[slot] + half_height };
+    return bounds;
+}
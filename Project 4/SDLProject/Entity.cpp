@@ -13,15 +13,12 @@
 #include "ShaderProgram.h"
 #include "Entity.h"
 
-Entity::Entity()
+Entity::Entity(EntityStore *store)
 {
-    m_position     = glm::vec3(0.0f);
-    m_velocity     = glm::vec3(0.0f);
-    m_acceleration = glm::vec3(0.0f);
+    // The store starts the slot at rest at the origin
+    m_store = store;
+    m_index = store->add(this);
     
-    m_movement = glm::vec3(0.0f);
-    
-    m_speed = 0;
     m_model_matrix = glm::mat4(1.0f);
 }
 
@@ -34,7 +31,7 @@ Entity::~Entity()
     delete [] m_walking;
 }
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram *program, GLuint texture_id, int index)
+void Entity::draw_sprite_from_texture_atlas(SpriteBatch *batch, GLuint texture_id, int index)
 {
     // Step 1: Calculate the UV location of the indexed frame
     float u_coord = (float) (index % m_animation_cols) / (float) m_animation_cols;
@@ -44,32 +41,14 @@ void Entity::draw_sprite_from_texture_atlas(ShaderProgram *program, GLuint textu
     float width = 1.0f / (float) m_animation_cols;
     float height = 1.0f / (float) m_animation_rows;
     
-    // Step 3: Just as we have done before, match the texture coordinates to the vertices
-    float tex_coords[] =
-    {
-        u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width, v_coord,
-        u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
-    };
-    
-    float vertices[] =
-    {
-        -0.5, -0.5, 0.5, -0.5,  0.5, 0.5,
-        -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
-    };
-    
-    // Step 4: And render
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    
-    glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->positionAttribute);
-    
-    glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->texCoordAttribute);
-    
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // Step 2.5: If the sheet lives in an atlas, squeeze those into the sheet's region
+    u_coord = m_texture_region.u + u_coord * m_texture_region.width;
+    v_coord = m_texture_region.v + v_coord * m_texture_region.height;
+    width  *= m_texture_region.width;
+    height *= m_texture_region.height;
     
-    glDisableVertexAttribArray(program->positionAttribute);
-    glDisableVertexAttribArray(program->texCoordAttribute);
+    // Step 3: Hand the frame over to the batch, which draws it together with everything else
+    batch->draw(texture_id, m_model_matrix, u_coord, v_coord, width, height);
 }
 
 void Entity::activate_ai(Entity *player)
@@ -94,21 +73,21 @@ void Entity::activate_ai(Entity *player)
 
 void Entity::ai_walker()
 {
-    m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
+    set_movement(glm::vec3(-1.0f, 0.0f, 0.0f));
 }
 
 void Entity::ai_guard(Entity *player)
 {
     switch (m_ai_state) {
         case IDLE:
-            if (glm::distance(m_position, player->get_position()) < 3.0f) m_ai_state = WALKING;
+            if (glm::distance(get_position(), player->get_position()) < 3.0f) m_ai_state = WALKING;
             break;
             
         case WALKING:
-            if (m_position.x > player->get_position().x) {
-                m_movement = glm::vec3(-1.0f, 0.0f, 0.0f);
+            if (position_x() > player->get_position().x) {
+                set_movement(glm::vec3(-1.0f, 0.0f, 0.0f));
             } else {
-                m_movement = glm::vec3(1.0f, 0.0f, 0.0f);
+                set_movement(glm::vec3(1.0f, 0.0f, 0.0f));
             }
             break;
             
@@ -128,9 +107,12 @@ void Entity::ai_jumper(){
     
 }
 
-void Entity::update(float delta_time, Entity *player, Entity *objects, int object_count, Map *map)
+void Entity::update(float delta_time, Entity *player, Entity *objects, int object_count, Map *map, AABBTree *colliders)
 {
     if (!m_is_active) return;
+    
+    m_store->previous_x[m_index] = position_x();
+    m_store->previous_y[m_index] = position_y();
  
     m_collided_top    = false;
     m_collided_bottom = false;
@@ -143,90 +125,101 @@ void Entity::update(float delta_time, Entity *player, Entity *objects, int objec
     
     if (m_animation_indices != NULL)
     {
-        if (glm::length(m_movement) != 0)
-        {
-            m_animation_time += delta_time;
-            float frames_per_second = (float) 1 / SECONDS_PER_FRAME;
-            
-            if (m_animation_time >= frames_per_second)
-            {
-                m_animation_time = 0.0f;
-                m_animation_index++;
-                
-                if (m_animation_index >= m_animation_frames)
-                {
-                    m_animation_index = 0;
-                }
-            }
-        }
+        float frames_per_second = (float) 1 / SECONDS_PER_FRAME;
+        EntityKernels::advance_animation(m_store, m_index, delta_time, frames_per_second);
     }
     
-    m_velocity.x = m_movement.x * m_speed;
-    m_velocity  += m_acceleration * delta_time;
+    EntityKernels::integrate_velocity(m_store, m_index, delta_time);
     
     // We make two calls to our check_collision methods, one for the collidable objects and one for
     // the map.
-    m_position.y += m_velocity.y * delta_time;
+    EntityKernels::integrate_position_y(m_store, m_index, delta_time);
     check_collision_y(objects, object_count);
+    if (colliders != NULL) check_collision_y(colliders);
     check_collision_y(map);
     
-    m_position.x += m_velocity.x * delta_time;
+    EntityKernels::integrate_position_x(m_store, m_index, delta_time);
     check_collision_x(objects, object_count);
+    if (colliders != NULL) check_collision_x(colliders);
     check_collision_x(map);
     
     if (m_is_jumping)
     {
         m_is_jumping = false;
         
-        m_velocity.y += m_jumping_power;
+        velocity_y() += m_jumping_power;
     }
     
     m_model_matrix = glm::mat4(1.0f);
-    m_model_matrix = glm::translate(m_model_matrix, m_position);
+    m_model_matrix = glm::translate(m_model_matrix, get_position());
 }
 
 void const Entity::check_collision_y(Entity *collidable_entities, int collidable_entity_count)
 {
-    for (int i = 0; i < collidable_entity_count; i++)
+    for (int i = 0; i < collidable_entity_count; i++) resolve_collision_y(&collidable_entities[i]);
+}
+
+void const Entity::check_collision_x(Entity *collidable_entities, int collidable_entity_count)
+{
+    for (int i = 0; i < collidable_entity_count; i++) resolve_collision_x(&collidable_entities[i]);
+}
+
+void const Entity::check_collision_y(AABBTree *colliders)
+{
+    Bounds bounds = get_bounds(m_store, m_index);
+    colliders->query(bounds.left, bounds.bottom, bounds.right, bounds.top, m_nearby_slots);
+    
+    for (size_t i = 0; i < m_nearby_slots.size(); i++)
     {
-        Entity *collidable_entity = &collidable_entities[i];
-        
-        if (check_collision(collidable_entity))
-        {
-            float y_distance = fabs(m_position.y - collidable_entity->get_position().y);
-            float y_overlap = fabs(y_distance - (m_height / 2.0f) - (collidable_entity->m_height / 2.0f));
-            if (m_position.y > 0) {
-                m_position.y   -= y_overlap;
-                m_velocity.y    = 0;
-                m_collided_top  = true;
-            } else if (m_velocity.y < 0) {
-                m_position.y      += y_overlap;
-                m_velocity.y       = 0;
-                m_collided_bottom  = true;
-            }
+        Entity *collidable_entity = m_store->owner[m_nearby_slots[i]];
+        if (collidable_entity != NULL) resolve_collision_y(collidable_entity);
+    }
+}
+
+void const Entity::check_collision_x(AABBTree *colliders)
+{
+    Bounds bounds = get_bounds(m_store, m_index);
+    colliders->query(bounds.left, bounds.bottom, bounds.right, bounds.top, m_nearby_slots);
+    
+    for (size_t i = 0; i < m_nearby_slots.size(); i++)
+    {
+        Entity *collidable_entity = m_store->owner[m_nearby_slots[i]];
+        if (collidable_entity != NULL) resolve_collision_x(collidable_entity);
+    }
+}
+
+void Entity::resolve_collision_y(Entity *collidable_entity)
+{
+    if (check_collision(collidable_entity))
+    {
+        float y_distance = fabs(position_y() - collidable_entity->get_position().y);
+        float y_overlap = fabs(y_distance - (height() / 2.0f) - (collidable_entity->height() / 2.0f));
+        if (position_y() > 0) {
+            position_y()   -= y_overlap;
+            velocity_y()    = 0;
+            m_collided_top  = true;
+        } else if (velocity_y() < 0) {
+            position_y()      += y_overlap;
+            velocity_y()       = 0;
+            m_collided_bottom  = true;
         }
     }
 }
 
-void const Entity::check_collision_x(Entity *collidable_entities, int collidable_entity_count)
+void Entity::resolve_collision_x(Entity *collidable_entity)
 {
-    for (int i = 0; i < collidable_entity_count; i++)
+    if (check_collision(collidable_entity))
     {
-        Entity *collidable_entity = &collidable_entities[i];
-        
-        if (check_collision(collidable_entity))
-        {
-            float x_distance = fabs(m_position.x - collidable_entity->get_position().x);
-            float x_overlap = fabs(x_distance - (m_width / 2.0f) - (collidable_entity->get_width() / 2.0f));
-            if (m_velocity.x > 0) {
-                m_position.x     -= x_overlap;
-                m_velocity.x      = 0;
-                m_collided_right  = true;
-            } else if (m_velocity.x < 0) {
-                m_position.x    += x_overlap;
-                m_velocity.x     = 0;
-                m_collided_left  = true;
-            }
+        float x_distance = fabs(position_x() - collidable_entity->get_position().x);
+        float x_overlap = fabs(x_distance - (width() / 2.0f) - (collidable_entity->get_width() / 2.0f));
+        if (velocity_x() > 0) {
+            position_x()     -= x_overlap;
+            velocity_x()      = 0;
+            m_collided_right  = true;
+        } else if (velocity_x() < 0) {
+            position_x()    += x_overlap;
+            velocity_x()     = 0;
+            m_collided_left  = true;
         }
     }
 }
@@ -234,55 +227,55 @@ void const Entity::check_collision_x(Entity *collidable_entities, int collidable
 void const Entity::check_collision_y(Map *map)
 {
     // Probes for tiles above
-    glm::vec3 top = glm::vec3(m_position.x, m_position.y + (m_height / 2), m_position.z);
-    glm::vec3 top_left = glm::vec3(m_position.x - (m_width / 2), m_position.y + (m_height / 2), m_position.z);
-    glm::vec3 top_right = glm::vec3(m_position.x + (m_width / 2), m_position.y + (m_height / 2), m_position.z);
+    glm::vec3 top = glm::vec3(position_x(), position_y() + (height() / 2), 0.0f);
+    glm::vec3 top_left = glm::vec3(position_x() - (width() / 2), position_y() + (height() / 2), 0.0f);
+    glm::vec3 top_right = glm::vec3(position_x() + (width() / 2), position_y() + (height() / 2), 0.0f);
     
     // Probes for tiles below
-    glm::vec3 bottom = glm::vec3(m_position.x, m_position.y - (m_height / 2), m_position.z);
-    glm::vec3 bottom_left = glm::vec3(m_position.x - (m_width / 2), m_position.y - (m_height / 2), m_position.z);
-    glm::vec3 bottom_right = glm::vec3(m_position.x + (m_width / 2), m_position.y - (m_height / 2), m_position.z);
+    glm::vec3 bottom = glm::vec3(position_x(), position_y() - (height() / 2), 0.0f);
+    glm::vec3 bottom_left = glm::vec3(position_x() - (width() / 2), position_y() - (height() / 2), 0.0f);
+    glm::vec3 bottom_right = glm::vec3(position_x() + (width() / 2), position_y() - (height() / 2), 0.0f);
     
     float penetration_x = 0;
     float penetration_y = 0;
     
     // If the map is solid, check the top three points
-    if (map->is_solid(top, &penetration_x, &penetration_y) && m_velocity.y > 0)
+    if (map->is_solid(top, &penetration_x, &penetration_y) && velocity_y() > 0)
     {
-        m_position.y -= penetration_y;
-        m_velocity.y = 0;
+        position_y() -= penetration_y;
+        velocity_y() = 0;
         m_collided_top = true;
     }
-    else if (map->is_solid(top_left, &penetration_x, &penetration_y) && m_velocity.y > 0)
+    else if (map->is_solid(top_left, &penetration_x, &penetration_y) && velocity_y() > 0)
     {
-        m_position.y -= penetration_y;
-        m_velocity.y = 0;
+        position_y() -= penetration_y;
+        velocity_y() = 0;
         m_collided_top = true;
     }
-    else if (map->is_solid(top_right, &penetration_x, &penetration_y) && m_velocity.y > 0)
+    else if (map->is_solid(top_right, &penetration_x, &penetration_y) && velocity_y() > 0)
     {
-        m_position.y -= penetration_y;
-        m_velocity.y = 0;
+        position_y() -= penetration_y;
+        velocity_y() = 0;
         m_collided_top = true;
     }
     
     // And the bottom three points
-    if (map->is_solid(bottom, &penetration_x, &penetration_y) && m_velocity.y < 0)
+    if (map->is_solid(bottom, &penetration_x, &penetration_y) && velocity_y() < 0)
     {
-        m_position.y += penetration_y;
-        m_velocity.y = 0;
+        position_y() += penetration_y;
+        velocity_y() = 0;
         m_collided_bottom = true;
     }
-    else if (map->is_solid(bottom_left, &penetration_x, &penetration_y) && m_velocity.y < 0)
+    else if (map->is_solid(bottom_left, &penetration_x, &penetration_y) && velocity_y() < 0)
     {
-            m_position.y += penetration_y;
-            m_velocity.y = 0;
+            position_y() += penetration_y;
+            velocity_y() = 0;
             m_collided_bottom = true;
     }
-    else if (map->is_solid(bottom_right, &penetration_x, &penetration_y) && m_velocity.y < 0)
+    else if (map->is_solid(bottom_right, &penetration_x, &penetration_y) && velocity_y() < 0)
     {
-        m_position.y += penetration_y;
-        m_velocity.y = 0;
+        position_y() += penetration_y;
+        velocity_y() = 0;
         m_collided_bottom = true;
         
     }
@@ -291,52 +284,93 @@ void const Entity::check_collision_y(Map *map)
 void const Entity::check_collision_x(Map *map)
 {
     // Probes for tiles; the x-checking is much simpler
-    glm::vec3 left  = glm::vec3(m_position.x - (m_width / 2), m_position.y, m_position.z);
-    glm::vec3 right = glm::vec3(m_position.x + (m_width / 2), m_position.y, m_position.z);
+    glm::vec3 left  = glm::vec3(position_x() - (width() / 2), position_y(), 0.0f);
+    glm::vec3 right = glm::vec3(position_x() + (width() / 2), position_y(), 0.0f);
     
     float penetration_x = 0;
     float penetration_y = 0;
     
-    if (map->is_solid(left, &penetration_x, &penetration_y) && m_velocity.x < 0)
+    if (map->is_solid(left, &penetration_x, &penetration_y) && velocity_x() < 0)
     {
-        m_position.x += penetration_x;
-        m_velocity.x = 0;
+        position_x() += penetration_x;
+        velocity_x() = 0;
         m_collided_left = true;
     }
-    if (map->is_solid(right, &penetration_x, &penetration_y) && m_velocity.x > 0)
+    if (map->is_solid(right, &penetration_x, &penetration_y) && velocity_x() > 0)
     {
-        m_position.x -= penetration_x;
-        m_velocity.x = 0;
+        position_x() -= penetration_x;
+        velocity_x() = 0;
         m_collided_right = true;
     }
 }
 
-void Entity::render(ShaderProgram *program)
+void Entity::render(SpriteBatch *batch)
 {
     if (!m_is_active) return;
     
-    program->SetModelMatrix(m_model_matrix);
-    
     if (m_animation_indices != NULL)
     {
-        draw_sprite_from_texture_atlas(program, m_texture_id, m_animation_indices[m_animation_index]);
+        draw_sprite_from_texture_atlas(batch, m_texture_id, m_animation_indices[animation_index()]);
         return;
     }
     
-    float vertices[]   = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = {  0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
-    
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
-    
-    glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->positionAttribute);
-    glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->texCoordAttribute);
+    // No animation, so the whole texture is our sprite
+    batch->draw(m_texture_id, m_model_matrix, m_texture_region.u, m_texture_region.v, m_texture_region.width, m_texture_region.height);
+}
+
+void Entity::render_instanced(InstancedSpriteRenderer *renderer)
+{
+    if (!m_is_active) return;
     
-    glDrawArrays(GL_TRIANGLES, 0, 6);
+    // The frame's UVs are worked out in the vertex shader, so all we hand over is the frame index
+    if (m_animation_indices != NULL)
+    {
+        renderer->draw(m_texture_id, m_texture_region, m_animation_cols, m_animation_rows, m_model_matrix, m_animation_indices[animation_index()]);
+        return;
+    }
     
-    glDisableVertexAttribArray(program->positionAttribute);
-    glDisableVertexAttribArray(program->texCoordAttribute);
+    // No animation, so the whole texture is a 1x1 sheet
+    renderer->draw(m_texture_id, m_texture_region, 1, 1, m_model_matrix, 0);
+}
+
+void Entity::interpolate(float alpha)
+{
+    // The simulation runs in fixed steps, but we usually render somewhere in between two of them.
+    // Drawing where we'd be that far into the step (instead of snapping to the last one) keeps
+    // movement smooth whatever the display rate is. We're one step behind, which is the price
+    m_model_matrix = glm::mat4(1.0f);
+    m_model_matrix = glm::translate(m_model_matrix, get_interpolated_position(alpha));
+}
+
+EntitySnapshot const Entity::get_snapshot() const
+{
+    EntitySnapshot snapshot;
+    snapshot.is_active         = m_is_active;
+    snapshot.previous_position = get_previous_position();
+    snapshot.position          = get_position();
+    snapshot.texture_id        = m_texture_id;
+    snapshot.texture_region    = m_texture_region;
+    snapshot.animation_indices = m_animation_indices;
+    snapshot.animation_index   = animation_index();
+    snapshot.animation_cols    = m_animation_cols;
+    snapshot.animation_rows    = m_animation_rows;
+    return snapshot;
+}
+
+void Entity::apply_snapshot(const EntitySnapshot &snapshot)
+{
+    // Only what render() looks at; this entity is a stand-in for drawing, not something we simulate
+    m_is_active                  = snapshot.is_active;
+    m_store->previous_x[m_index] = snapshot.previous_position.x;
+    m_store->previous_y[m_index] = snapshot.previous_position.y;
+    position_x()                 = snapshot.position.x;
+    position_y()                 = snapshot.position.y;
+    m_texture_id                 = snapshot.texture_id;
+    m_texture_region             = snapshot.texture_region;
+    m_animation_indices          = snapshot.animation_indices;
+    animation_index()            = snapshot.animation_index;
+    m_animation_cols             = snapshot.animation_cols;
+    m_animation_rows             = snapshot.animation_rows;
 }
 
 bool const Entity::check_collision(Entity *other) const
@@ -347,8 +381,8 @@ bool const Entity::check_collision(Entity *other) const
     // If either entity is inactive, there shouldn't be any collision
     if (!m_is_active || !other->m_is_active) return false;
     
-    float x_distance = fabs(m_position.x - other->m_position.x) - ((m_width  + other->m_width)  / 2.0f);
-    float y_distance = fabs(m_position.y - other->m_position.y) - ((m_height + other->m_height) / 2.0f);
+    float x_distance = fabs(position_x() - other->position_x()) - ((width()  + other->width())  / 2.0f);
+    float y_distance = fabs(position_y() - other->position_y()) - ((height() + other->height()) / 2.0f);
     
     return x_distance < 0.0f && y_distance < 0.0f;
 }
@@ -1,9 +1,29 @@
 #include "Map.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteRenderer.h"
+#include "EntityStore.h"
+#include "EntityKernels.h"
+#include "AABBTree.h"
 
 enum EntityType { PLATFORM, PLAYER, ENEMY  };
 enum AIType     { WALKER, GUARD,  JUMPER   };
 enum AIState    { WALKING, IDLE, JUMPING };
 
+// Everything the renderer needs from an entity, copied out in one go so the simulation
+// can carry on changing the entity while a frame is drawn from the copy
+struct EntitySnapshot
+{
+    bool        is_active;
+    glm::vec3   previous_position;
+    glm::vec3   position;
+    GLuint      texture_id;
+    AtlasRegion texture_region;
+    int        *animation_indices;  // The walking arrays are set up once and never change, so sharing them is fine
+    int         animation_index;
+    int         animation_cols;
+    int         animation_rows;
+};
+
 class Entity
 {
 private:
@@ -17,12 +37,27 @@ private:
     int *m_animation_up    = NULL; // move upwards
     int *m_animation_down  = NULL; // move downwards
     
-    glm::vec3 m_position;
-    glm::vec3 m_velocity;
-    glm::vec3 m_acceleration;
+    // Position, velocity, acceleration, movement, speed, size and the walk cycle's timer live
+    // in the store, in slot m_index
+    EntityStore *m_store;
+    int m_index;
+    
+    // Where check_collision_x/y(AABBTree*) collect what the tree found, kept between steps so
+    // querying doesn't allocate
+    std::vector<int> m_nearby_slots;
     
-    float m_width  = 0.8f;
-    float m_height = 0.8f;
+    // Shorthands for our slot, so the collision code reads the way it did with glm::vec3s
+    float &position_x() const { return m_store->position_x[m_index]; };
+    float &position_y() const { return m_store->position_y[m_index]; };
+    float &velocity_x() const { return m_store->velocity_x[m_index]; };
+    float &velocity_y() const { return m_store->velocity_y[m_index]; };
+    float &width()      const { return m_store->width[m_index];      };
+    float &height()     const { return m_store->height[m_index];     };
+    int   &animation_index() const { return m_store->animation_index[m_index]; };
+    
+    // Pushes us back out of one other entity we've run into, along one axis
+    void resolve_collision_y(Entity *collidable_entity);
+    void resolve_collision_x(Entity *collidable_entity);
     
 public:
     // Static attributes
@@ -34,18 +69,12 @@ public:
     
     // Existing
     GLuint m_texture_id;
+    AtlasRegion m_texture_region; // Where the sprite sheet sits if m_texture_id is an atlas
     glm::mat4 m_model_matrix;
     
-    // Translating
-    float m_speed;
-    glm::vec3 m_movement;
-    
     // Animating
     int **m_walking          = new int*[4] { m_animation_left, m_animation_right, m_animation_up, m_animation_down };
     int *m_animation_indices = NULL;
-    int m_animation_frames   = 0;
-    int m_animation_index    = 0;
-    float m_animation_time   = 0.0f;
     int m_animation_cols     = 0;
     int m_animation_rows     = 0;
     
@@ -60,12 +89,17 @@ public:
     bool m_collided_right  = false;
 
     // Methods
-    Entity();
+    Entity(EntityStore *store);
     ~Entity();
 
-    void draw_sprite_from_texture_atlas(ShaderProgram *program, GLuint texture_id, int index);
-    void update(float delta_time, Entity *player, Entity *objects, int object_count, Map *map); // Now, update should check for both objects in the game AND the map
-    void render(ShaderProgram *program);
+    void draw_sprite_from_texture_atlas(SpriteBatch *batch, GLuint texture_id, int index);
+    void update(float delta_time, Entity *player, Entity *objects, int object_count, Map *map, AABBTree *colliders = NULL); // Now, update should check for both objects in the game AND the map
+    void render(SpriteBatch *batch);
+    void render_instanced(InstancedSpriteRenderer *renderer);
+    void interpolate(float alpha);
+    
+    EntitySnapshot const get_snapshot() const;
+    void apply_snapshot(const EntitySnapshot &snapshot);
     void activate_ai(Entity *player);
     void ai_walker();
     void ai_guard(Entity *player);
@@ -78,6 +112,11 @@ public:
     void const check_collision_y(Map *map);
     void const check_collision_x(Map *map);
     
+    // And for whatever the tree has near us. It has to be tracking our store, and be updated
+    // once per step before anyone moves
+    void const check_collision_y(AABBTree *colliders);
+    void const check_collision_x(AABBTree *colliders);
+    
     bool const check_collision(Entity *other) const;
     
     void activate()   { m_is_active = true;  };
@@ -86,24 +125,36 @@ public:
     EntityType const get_entity_type()    const { return m_entity_type;   };
     AIType     const get_ai_type()        const { return m_ai_type;       };
     AIState    const get_ai_state()       const { return m_ai_state;      };
-    glm::vec3  const get_position()       const { return m_position;      };
-    glm::vec3  const get_movement()       const { return m_movement;      };
-    glm::vec3  const get_velocity()       const { return m_velocity;      };
-    glm::vec3  const get_acceleration()   const { return m_acceleration;  };
+    glm::vec3  const get_position()       const { return glm::vec3(m_store->position_x[m_index],     m_store->position_y[m_index],     0.0f); };
+    glm::vec3  const get_previous_position() const { return glm::vec3(m_store->previous_x[m_index], m_store->previous_y[m_index],     0.0f); };
+    glm::vec3  const get_movement()       const { return glm::vec3(m_store->movement_x[m_index],     m_store->movement_y[m_index],     0.0f); };
+    glm::vec3  const get_interpolated_position(float alpha) const { return glm::mix(get_previous_position(), get_position(), alpha); };
+    glm::vec3  const get_velocity()       const { return glm::vec3(m_store->velocity_x[m_index],     m_store->velocity_y[m_index],     0.0f); };
+    glm::vec3  const get_acceleration()   const { return glm::vec3(m_store->acceleration_x[m_index], m_store->acceleration_y[m_index], 0.0f); };
     float      const get_jumping_power () const { return m_jumping_power; };
-    float      const get_speed()          const { return m_speed;         };
-    int        const get_width()          const { return m_width;         };
-    int        const get_height()         const { return m_height;        };
+    float      const get_speed()          const { return m_store->speed[m_index]; };
+    EntityStore * const get_store()       const { return m_store;         };
+    int        const get_index()          const { return m_index;         };
+    int        const get_width()          const { return m_store->width[m_index];  };
+    int        const get_height()         const { return m_store->height[m_index]; };
+    int        const get_animation_index() const { return m_store->animation_index[m_index]; };
     
     void const set_entity_type(EntityType new_entity_type)  { m_entity_type   = new_entity_type;      };
     void const set_ai_type(AIType new_ai_type)              { m_ai_type       = new_ai_type;          };
     void const set_ai_state(AIState new_state)              { m_ai_state      = new_state;            };
-    void const set_position(glm::vec3 new_position)         { m_position      = new_position;         };
-    void const set_movement(glm::vec3 new_movement)         { m_movement      = new_movement;         };
-    void const set_velocity(glm::vec3 new_velocity)         { m_velocity      = new_velocity;         };
-    void const set_speed(float new_speed)                   { m_speed         = new_speed;            };
+    void const set_position(glm::vec3 new_position)
+    {
+        m_store->position_x[m_index] = m_store->previous_x[m_index] = new_position.x;
+        m_store->position_y[m_index] = m_store->previous_y[m_index] = new_position.y;
+    };
+    void const set_movement(glm::vec3 new_movement)         { m_store->movement_x[m_index]     = new_movement.x;     m_store->movement_y[m_index]     = new_movement.y;     };
+    void const set_velocity(glm::vec3 new_velocity)         { m_store->velocity_x[m_index]     = new_velocity.x;     m_store->velocity_y[m_index]     = new_velocity.y;     };
+    void const set_speed(float new_speed)                   { m_store->speed[m_index]          = new_speed;          };
     void const set_jumping_power(float new_jumping_power)   { m_jumping_power = new_jumping_power;   };
-    void const set_acceleration(glm::vec3 new_acceleration) { m_acceleration  = new_acceleration;     };
-    void const set_width(float new_width)                   { m_width         = new_width;            };
-    void const set_height(float new_height)                 { m_height        = new_height;           };
+    void const set_acceleration(glm::vec3 new_acceleration) { m_store->acceleration_x[m_index] = new_acceleration.x; m_store->acceleration_y[m_index] = new_acceleration.y; };
+    void const set_width(float new_width)                   { m_store->width[m_index]          = new_width;          };
+    void const set_height(float new_height)                 { m_store->height[m_index]         = new_height;         };
+    void const set_animation_frames(int new_frames)         { m_store->animation_frames[m_index] = new_frames;       };
+    void const set_animation_index(int new_index)           { m_store->animation_index[m_index]  = new_index;        };
+    void const set_animation_time(float new_time)           { m_store->animation_time[m_index]   = new_time;         };
 };
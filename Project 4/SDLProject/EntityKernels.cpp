@@ -0,0 +1,587 @@
+// A multiply followed by an add has to round twice in every version below. Left to itself the
+// compiler may turn the plain C++ ones into a single fused instruction that only rounds once
+// (clang does on ARM, for instance), and then they'd no longer match the SIMD ones
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC optimize ("fp-contract=off")
+#endif
+
+#include <math.h>
+#include <string.h>
+#include "EntityKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_SSE2 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+// Only 64-bit ARM; 32-bit NEON flushes tiny floats to zero, so it wouldn't match the scalar versions
+#define HAS_NEON 1
+#include <arm_neon.h>
+#endif
+
+// The AVX2 functions are compiled in even when the rest of the file isn't built for AVX2,
+// and only called once we know the CPU has it
+#if defined(HAS_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#else
+#define AVX2_FUNCTION
+#endif
+
+static bool cpu_has_avx2()
+{
+#if defined(HAS_SSE2) && (defined(__GNUC__) || defined(__clang__))
+    __builtin_cpu_init();  // We run before main, possibly before anyone else has asked
+    return __builtin_cpu_supports("avx2");
+#elif defined(HAS_SSE2) && defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 0);
+    if (registers[0] < 7) return false;
+    
+    // The CPU has to support AVX and the OS has to save the wider registers when switching threads
+    __cpuid(registers, 1);
+    bool has_avx = (registers[2] & (1 << 27)) && (registers[2] & (1 << 28));
+    if (!has_avx || (_xgetbv(0) & 6) != 6) return false;
+    
+    __cpuidex(registers, 7, 0);
+    return (registers[1] & (1 << 5)) != 0;
+#else
+    return false;
+#endif
+}
+
+static InstructionSet widest_instruction_set()
+{
+    if (EntityKernels::is_supported(AVX2_INSTRUCTIONS)) return AVX2_INSTRUCTIONS;
+    if (EntityKernels::is_supported(SSE2_INSTRUCTIONS)) return SSE2_INSTRUCTIONS;
+    if (EntityKernels::is_supported(NEON_INSTRUCTIONS)) return NEON_INSTRUCTIONS;
+    return SCALAR_INSTRUCTIONS;
+}
+
+InstructionSet EntityKernels::s_instruction_set = widest_instruction_set();
+
+bool EntityKernels::is_supported(InstructionSet instruction_set)
+{
+    switch (instruction_set)
+    {
+        case SCALAR_INSTRUCTIONS:
+            return true;
+
+#ifdef HAS_SSE2
+        case SSE2_INSTRUCTIONS:
+            return true;
+    
+        case AVX2_INSTRUCTIONS:
+            return cpu_has_avx2();
+#endif
+
+#ifdef HAS_NEON
+        case NEON_INSTRUCTIONS:
+            return true;
+#endif
+
+        default:
+            return false;
+    }
+}
+
+bool EntityKernels::select(InstructionSet instruction_set)
+{
+    if (!is_supported(instruction_set)) return false;
+    
+    s_instruction_set = instruction_set;
+    return true;
+}
+
+InstructionSet EntityKernels::get_instruction_set()
+{
+    return s_instruction_set;
+}
+
+const char *EntityKernels::get_name(InstructionSet instruction_set)
+{
+    switch (instruction_set)
+    {
+        case SSE2_INSTRUCTIONS: return "sse2";
+        case AVX2_INSTRUCTIONS: return "avx2";
+        case NEON_INSTRUCTIONS: return "neon";
+        default:                return "scalar";
+    }
+}
+
+// ————— SCALAR ————— //
+// Each of these does slots [first, last), one at a time
+
+static void scalar_integrate_velocity(EntityStore *store, int first, int last, float delta_time)
+{
+    for (int i = first; i < last; i++)
+    {
+        float velocity = store->movement_x[i] * store->speed[i];
+        store->velocity_x[i] = velocity + store->acceleration_x[i] * delta_time;
+        store->velocity_y[i] = store->velocity_y[i] + store->acceleration_y[i] * delta_time;
+    }
+}
+
+static void scalar_integrate_position_x(EntityStore *store, int first, int last, float delta_time)
+{
+    for (int i = first; i < last; i++) store->position_x[i] = store->position_x[i] + store->velocity_x[i] * delta_time;
+}
+
+static void scalar_integrate_position_y(EntityStore *store, int first, int last, float delta_time)
+{
+    for (int i = first; i < last; i++) store->position_y[i] = store->position_y[i] + store->velocity_y[i] * delta_time;
+}
+
+static void scalar_advance_animations(EntityStore *store, int first, int last, float delta_time, float frame_duration)
+{
+    for (int i = first; i < last; i++)
+    {
+        if (store->animation_frames[i] <= 0) continue;
+        if (store->movement_x[i] == 0.0f && store->movement_y[i] == 0.0f) continue;
+    
+        store->animation_time[i] += delta_time;
+    
+        if (store->animation_time[i] >= frame_duration)
+        {
+            store->animation_time[i] = 0.0f;
+            store->animation_index[i]++;
+    
+            if (store->animation_index[i] >= store->animation_frames[i]) store->animation_index[i] = 0;
+        }
+    }
+}
+
+static int scalar_find_overlaps(EntityStore *store, int first, int last, float x, float y, float width, float height, unsigned char *hits)
+{
+    int hit_count = 0;
+    
+    for (int i = first; i < last; i++)
+    {
+        float x_distance = fabsf(store->position_x[i] - x) - (store->width[i]  + width)  * 0.5f;
+        float y_distance = fabsf(store->position_y[i] - y) - (store->height[i] + height) * 0.5f;
+    
+        hits[i] = x_distance < 0.0f && y_distance < 0.0f;
+        hit_count += hits[i];
+    }
+    
+    return hit_count;
+}
+
+// ————— SSE2 AND AVX2 ————— //
+// Each of these does as many whole batches as fit, and returns how many slots that came to.
+// The rest go through the scalar versions above
+#ifdef HAS_SSE2
+
+static int sse2_integrate_velocity(EntityStore *store, int count, float delta_time)
+{
+    __m128 step = _mm_set1_ps(delta_time);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 velocity = _mm_mul_ps(_mm_loadu_ps(&store->movement_x[i]), _mm_loadu_ps(&store->speed[i]));
+        velocity = _mm_add_ps(velocity, _mm_mul_ps(_mm_loadu_ps(&store->acceleration_x[i]), step));
+        _mm_storeu_ps(&store->velocity_x[i], velocity);
+    
+        velocity = _mm_add_ps(_mm_loadu_ps(&store->velocity_y[i]), _mm_mul_ps(_mm_loadu_ps(&store->acceleration_y[i]), step));
+        _mm_storeu_ps(&store->velocity_y[i], velocity);
+    }
+    
+    return i;
+}
+
+static int sse2_integrate_position(EntityStore *store, int count, float delta_time)
+{
+    __m128 step = _mm_set1_ps(delta_time);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 position = _mm_add_ps(_mm_loadu_ps(&store->position_x[i]), _mm_mul_ps(_mm_loadu_ps(&store->velocity_x[i]), step));
+        _mm_storeu_ps(&store->position_x[i], position);
+    
+        position = _mm_add_ps(_mm_loadu_ps(&store->position_y[i]), _mm_mul_ps(_mm_loadu_ps(&store->velocity_y[i]), step));
+        _mm_storeu_ps(&store->position_y[i], position);
+    }
+    
+    return i;
+}
+
+static int sse2_advance_animations(EntityStore *store, int count, float delta_time, float frame_duration)
+{
+    __m128  step     = _mm_set1_ps(delta_time);
+    __m128  duration = _mm_set1_ps(frame_duration);
+    __m128  zero     = _mm_setzero_ps();
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        // Lanes are all ones where the condition holds and all zeros where it doesn't
+        __m128  moving   = _mm_or_ps(_mm_cmpneq_ps(_mm_loadu_ps(&store->movement_x[i]), zero),
+                                     _mm_cmpneq_ps(_mm_loadu_ps(&store->movement_y[i]), zero));
+        __m128i frames   = _mm_loadu_si128((const __m128i *) &store->animation_frames[i]);
+        __m128  animated = _mm_and_ps(moving, _mm_castsi128_ps(_mm_cmpgt_epi32(frames, _mm_setzero_si128())));
+    
+        // SSE2 has no blend, so pick between the two times with masks
+        __m128 time = _mm_loadu_ps(&store->animation_time[i]);
+        time = _mm_or_ps(_mm_and_ps(animated, _mm_add_ps(time, step)), _mm_andnot_ps(animated, time));
+    
+        __m128 wrapped = _mm_and_ps(animated, _mm_cmpge_ps(time, duration));
+        _mm_storeu_ps(&store->animation_time[i], _mm_andnot_ps(wrapped, time));
+    
+        // Subtracting an all-ones lane (-1) adds one to the frame
+        __m128i wrapped_lanes = _mm_castps_si128(wrapped);
+        __m128i index    = _mm_sub_epi32(_mm_loadu_si128((const __m128i *) &store->animation_index[i]), wrapped_lanes);
+        __m128i past_end = _mm_andnot_si128(_mm_cmpgt_epi32(frames, index), wrapped_lanes);
+        _mm_storeu_si128((__m128i *) &store->animation_index[i], _mm_andnot_si128(past_end, index));
+    }
+    
+    return i;
+}
+
+static int sse2_find_overlaps(EntityStore *store, int count, float x, float y, float width, float height, unsigned char *hits, int *hit_count)
+{
+    __m128 box_x      = _mm_set1_ps(x);
+    __m128 box_y      = _mm_set1_ps(y);
+    __m128 box_width  = _mm_set1_ps(width);
+    __m128 box_height = _mm_set1_ps(height);
+    __m128 half       = _mm_set1_ps(0.5f);
+    __m128 zero       = _mm_setzero_ps();
+    __m128 magnitude  = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));  // Clearing the sign bit is fabsf
+    __m128i counts    = _mm_setzero_si128();
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 x_distance = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&store->position_x[i]), box_x), magnitude);
+        __m128 y_distance = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(&store->position_y[i]), box_y), magnitude);
+        x_distance = _mm_sub_ps(x_distance, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&store->width[i]),  box_width),  half));
+        y_distance = _mm_sub_ps(y_distance, _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(&store->height[i]), box_height), half));
+    
+        __m128i hit = _mm_castps_si128(_mm_and_ps(_mm_cmplt_ps(x_distance, zero), _mm_cmplt_ps(y_distance, zero)));
+        counts = _mm_sub_epi32(counts, hit);
+    
+        // Squeeze the four all-ones/all-zeros lanes down to four bytes, then keep one bit of each
+        __m128i bytes  = _mm_packs_epi16(_mm_packs_epi32(hit, hit), hit);
+        int     packed = _mm_cvtsi128_si32(bytes) & 0x01010101;
+        memcpy(&hits[i], &packed, 4);
+    }
+    
+    int lanes[4];
+    _mm_storeu_si128((__m128i *) lanes, counts);
+    *hit_count += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    
+    return i;
+}
+
+static AVX2_FUNCTION int avx2_integrate_velocity(EntityStore *store, int count, float delta_time)
+{
+    __m256 step = _mm256_set1_ps(delta_time);
+    int i = 0;
+    
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 velocity = _mm256_mul_ps(_mm256_loadu_ps(&store->movement_x[i]), _mm256_loadu_ps(&store->speed[i]));
+        velocity = _mm256_add_ps(velocity, _mm256_mul_ps(_mm256_loadu_ps(&store->acceleration_x[i]), step));
+        _mm256_storeu_ps(&store->velocity_x[i], velocity);
+    
+        velocity = _mm256_add_ps(_mm256_loadu_ps(&store->velocity_y[i]), _mm256_mul_ps(_mm256_loadu_ps(&store->acceleration_y[i]), step));
+        _mm256_storeu_ps(&store->velocity_y[i], velocity);
+    }
+    
+    return i;
+}
+
+static AVX2_FUNCTION int avx2_integrate_position(EntityStore *store, int count, float delta_time)
+{
+    __m256 step = _mm256_set1_ps(delta_time);
+    int i = 0;
+    
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 position = _mm256_add_ps(_mm256_loadu_ps(&store->position_x[i]), _mm256_mul_ps(_mm256_loadu_ps(&store->velocity_x[i]), step));
+        _mm256_storeu_ps(&store->position_x[i], position);
+    
+        position = _mm256_add_ps(_mm256_loadu_ps(&store->position_y[i]), _mm256_mul_ps(_mm256_loadu_ps(&store->velocity_y[i]), step));
+        _mm256_storeu_ps(&store->position_y[i], position);
+    }
+    
+    return i;
+}
+
+static AVX2_FUNCTION int avx2_advance_animations(EntityStore *store, int count, float delta_time, float frame_duration)
+{
+    __m256 step     = _mm256_set1_ps(delta_time);
+    __m256 duration = _mm256_set1_ps(frame_duration);
+    __m256 zero     = _mm256_setzero_ps();
+    int i = 0;
+    
+    // Same as the SSE2 version, eight at a time and with a real blend
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256  moving   = _mm256_or_ps(_mm256_cmp_ps(_mm256_loadu_ps(&store->movement_x[i]), zero, _CMP_NEQ_UQ),
+                                        _mm256_cmp_ps(_mm256_loadu_ps(&store->movement_y[i]), zero, _CMP_NEQ_UQ));
+        __m256i frames   = _mm256_loadu_si256((const __m256i *) &store->animation_frames[i]);
+        __m256  animated = _mm256_and_ps(moving, _mm256_castsi256_ps(_mm256_cmpgt_epi32(frames, _mm256_setzero_si256())));
+    
+        __m256 time = _mm256_loadu_ps(&store->animation_time[i]);
+        time = _mm256_blendv_ps(time, _mm256_add_ps(time, step), animated);
+    
+        __m256 wrapped = _mm256_and_ps(animated, _mm256_cmp_ps(time, duration, _CMP_GE_OQ));
+        _mm256_storeu_ps(&store->animation_time[i], _mm256_andnot_ps(wrapped, time));
+    
+        __m256i wrapped_lanes = _mm256_castps_si256(wrapped);
+        __m256i index    = _mm256_sub_epi32(_mm256_loadu_si256((const __m256i *) &store->animation_index[i]), wrapped_lanes);
+        __m256i past_end = _mm256_andnot_si256(_mm256_cmpgt_epi32(frames, index), wrapped_lanes);
+        _mm256_storeu_si256((__m256i *) &store->animation_index[i], _mm256_andnot_si256(past_end, index));
+    }
+    
+    return i;
+}
+
+static AVX2_FUNCTION int avx2_find_overlaps(EntityStore *store, int count, float x, float y, float width, float height, unsigned char *hits, int *hit_count)
+{
+    __m256 box_x      = _mm256_set1_ps(x);
+    __m256 box_y      = _mm256_set1_ps(y);
+    __m256 box_width  = _mm256_set1_ps(width);
+    __m256 box_height = _mm256_set1_ps(height);
+    __m256 half       = _mm256_set1_ps(0.5f);
+    __m256 zero       = _mm256_setzero_ps();
+    __m256 magnitude  = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256i counts    = _mm256_setzero_si256();
+    int i = 0;
+    
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256 x_distance = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(&store->position_x[i]), box_x), magnitude);
+        __m256 y_distance = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(&store->position_y[i]), box_y), magnitude);
+        x_distance = _mm256_sub_ps(x_distance, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&store->width[i]),  box_width),  half));
+        y_distance = _mm256_sub_ps(y_distance, _mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(&store->height[i]), box_height), half));
+    
+        __m256i hit = _mm256_castps_si256(_mm256_and_ps(_mm256_cmp_ps(x_distance, zero, _CMP_LT_OQ), _mm256_cmp_ps(y_distance, zero, _CMP_LT_OQ)));
+        counts = _mm256_sub_epi32(counts, hit);
+    
+        // The packs work on each 128-bit half separately, so each half ends up with four of the bytes
+        __m256i bytes = _mm256_packs_epi16(_mm256_packs_epi32(hit, hit), hit);
+        int low  = _mm_cvtsi128_si32(_mm256_castsi256_si128(bytes))      & 0x01010101;
+        int high = _mm_cvtsi128_si32(_mm256_extracti128_si256(bytes, 1)) & 0x01010101;
+        memcpy(&hits[i],     &low,  4);
+        memcpy(&hits[i + 4], &high, 4);
+    }
+    
+    int lanes[8];
+    _mm256_storeu_si256((__m256i *) lanes, counts);
+    for (int lane = 0; lane < 8; lane++) *hit_count += lanes[lane];
+    
+    return i;
+}
+
+#endif
+
+// ————— NEON ————— //
+#ifdef HAS_NEON
+
+static int neon_integrate_velocity(EntityStore *store, int count, float delta_time)
+{
+    float32x4_t step = vdupq_n_f32(delta_time);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t velocity = vmulq_f32(vld1q_f32(&store->movement_x[i]), vld1q_f32(&store->speed[i]));
+        velocity = vaddq_f32(velocity, vmulq_f32(vld1q_f32(&store->acceleration_x[i]), step));
+        vst1q_f32(&store->velocity_x[i], velocity);
+    
+        velocity = vaddq_f32(vld1q_f32(&store->velocity_y[i]), vmulq_f32(vld1q_f32(&store->acceleration_y[i]), step));
+        vst1q_f32(&store->velocity_y[i], velocity);
+    }
+    
+    return i;
+}
+
+static int neon_integrate_position(EntityStore *store, int count, float delta_time)
+{
+    float32x4_t step = vdupq_n_f32(delta_time);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t position = vaddq_f32(vld1q_f32(&store->position_x[i]), vmulq_f32(vld1q_f32(&store->velocity_x[i]), step));
+        vst1q_f32(&store->position_x[i], position);
+    
+        position = vaddq_f32(vld1q_f32(&store->position_y[i]), vmulq_f32(vld1q_f32(&store->velocity_y[i]), step));
+        vst1q_f32(&store->position_y[i], position);
+    }
+    
+    return i;
+}
+
+static int neon_advance_animations(EntityStore *store, int count, float delta_time, float frame_duration)
+{
+    float32x4_t step     = vdupq_n_f32(delta_time);
+    float32x4_t duration = vdupq_n_f32(frame_duration);
+    float32x4_t zero     = vdupq_n_f32(0.0f);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        uint32x4_t moving   = vorrq_u32(vmvnq_u32(vceqq_f32(vld1q_f32(&store->movement_x[i]), zero)),
+                                        vmvnq_u32(vceqq_f32(vld1q_f32(&store->movement_y[i]), zero)));
+        int32x4_t  frames   = vld1q_s32(&store->animation_frames[i]);
+        uint32x4_t animated = vandq_u32(moving, vcgtq_s32(frames, vdupq_n_s32(0)));
+    
+        float32x4_t time = vld1q_f32(&store->animation_time[i]);
+        time = vbslq_f32(animated, vaddq_f32(time, step), time);
+    
+        uint32x4_t wrapped = vandq_u32(animated, vcgeq_f32(time, duration));
+        vst1q_f32(&store->animation_time[i], vreinterpretq_f32_u32(vbicq_u32(vreinterpretq_u32_f32(time), wrapped)));
+    
+        int32x4_t  index    = vsubq_s32(vld1q_s32(&store->animation_index[i]), vreinterpretq_s32_u32(wrapped));
+        uint32x4_t past_end = vandq_u32(wrapped, vcgeq_s32(index, frames));
+        vst1q_s32(&store->animation_index[i], vbicq_s32(index, vreinterpretq_s32_u32(past_end)));
+    }
+    
+    return i;
+}
+
+static int neon_find_overlaps(EntityStore *store, int count, float x, float y, float width, float height, unsigned char *hits, int *hit_count)
+{
+    float32x4_t box_x      = vdupq_n_f32(x);
+    float32x4_t box_y      = vdupq_n_f32(y);
+    float32x4_t box_width  = vdupq_n_f32(width);
+    float32x4_t box_height = vdupq_n_f32(height);
+    float32x4_t half       = vdupq_n_f32(0.5f);
+    float32x4_t zero       = vdupq_n_f32(0.0f);
+    uint32x4_t  counts     = vdupq_n_u32(0);
+    int i = 0;
+    
+    for (; i + 4 <= count; i += 4)
+    {
+        float32x4_t x_distance = vabsq_f32(vsubq_f32(vld1q_f32(&store->position_x[i]), box_x));
+        float32x4_t y_distance = vabsq_f32(vsubq_f32(vld1q_f32(&store->position_y[i]), box_y));
+        x_distance = vsubq_f32(x_distance, vmulq_f32(vaddq_f32(vld1q_f32(&store->width[i]),  box_width),  half));
+        y_distance = vsubq_f32(y_distance, vmulq_f32(vaddq_f32(vld1q_f32(&store->height[i]), box_height), half));
+    
+        uint32x4_t hit = vandq_u32(vcltq_f32(x_distance, zero), vcltq_f32(y_distance, zero));
+        counts = vsubq_u32(counts, hit);
+    
+        // Narrow the four lanes down to bytes and keep one bit of each
+        uint16x4_t words = vmovn_u32(hit);
+        uint8_t    bytes[8];
+        vst1_u8(bytes, vand_u8(vmovn_u16(vcombine_u16(words, words)), vdup_n_u8(1)));
+        memcpy(&hits[i], bytes, 4);
+    }
+    
+    *hit_count += (int) vaddvq_u32(counts);
+    
+    return i;
+}
+
+#endif
+
+// ————— DISPATCH ————— //
+
+void EntityKernels::integrate_velocity(EntityStore *store, float delta_time)
+{
+    int count = store->get_count(),
+        done  = 0;
+    
+    switch (s_instruction_set)
+    {
+#ifdef HAS_SSE2
+        case AVX2_INSTRUCTIONS: done = avx2_integrate_velocity(store, count, delta_time); break;
+        case SSE2_INSTRUCTIONS: done = sse2_integrate_velocity(store, count, delta_time); break;
+#endif
+#ifdef HAS_NEON
+        case NEON_INSTRUCTIONS: done = neon_integrate_velocity(store, count, delta_time); break;
+#endif
+        default: break;
+    }
+    
+    scalar_integrate_velocity(store, done, count, delta_time);
+}
+
+void EntityKernels::integrate_position(EntityStore *store, float delta_time)
+{
+    int count = store->get_count(),
+        done  = 0;
+    
+    switch (s_instruction_set)
+    {
+#ifdef HAS_SSE2
+        case AVX2_INSTRUCTIONS: done = avx2_integrate_position(store, count, delta_time); break;
+        case SSE2_INSTRUCTIONS: done = sse2_integrate_position(store, count, delta_time); break;
+#endif
+#ifdef HAS_NEON
+        case NEON_INSTRUCTIONS: done = neon_integrate_position(store, count, delta_time); break;
+#endif
+        default: break;
+    }
+    
+    scalar_integrate_position_x(store, done, count, delta_time);
+    scalar_integrate_position_y(store, done, count, delta_time);
+}
+
+void EntityKernels::advance_animations(EntityStore *store, float delta_time, float frame_duration)
+{
+    int count = store->get_count(),
+        done  = 0;
+    
+    switch (s_instruction_set)
+    {
+#ifdef HAS_SSE2
+        case AVX2_INSTRUCTIONS: done = avx2_advance_animations(store, count, delta_time, frame_duration); break;
+        case SSE2_INSTRUCTIONS: done = sse2_advance_animations(store, count, delta_time, frame_duration); break;
+#endif
+#ifdef HAS_NEON
+        case NEON_INSTRUCTIONS: done = neon_advance_animations(store, count, delta_time, frame_duration); break;
+#endif
+        default: break;
+    }
+    
+    scalar_advance_animations(store, done, count, delta_time, frame_duration);
+}
+
+int EntityKernels::find_overlaps(EntityStore *store, float x, float y, float width, float height, unsigned char *hits)
+{
+    int count     = store->get_count(),
+        done      = 0,
+        hit_count = 0;
+    
+    switch (s_instruction_set)
+    {
+#ifdef HAS_SSE2
+        case AVX2_INSTRUCTIONS: done = avx2_find_overlaps(store, count, x, y, width, height, hits, &hit_count); break;
+        case SSE2_INSTRUCTIONS: done = sse2_find_overlaps(store, count, x, y, width, height, hits, &hit_count); break;
+#endif
+#ifdef HAS_NEON
+        case NEON_INSTRUCTIONS: done = neon_find_overlaps(store, count, x, y, width, height, hits, &hit_count); break;
+#endif
+        default: break;
+    }
+    
+    return hit_count + scalar_find_overlaps(store, done, count, x, y, width, height, hits);
+}
+
+void EntityKernels::integrate_velocity(EntityStore *store, int index, float delta_time)
+{
+    scalar_integrate_velocity(store, index, index + 1, delta_time);
+}
+
+void EntityKernels::integrate_position_x(EntityStore *store, int index, float delta_time)
+{
+    scalar_integrate_position_x(store, index, index + 1, delta_time);
+}
+
+void EntityKernels::integrate_position_y(EntityStore *store, int index, float delta_time)
+{
+    scalar_integrate_position_y(store, index, index + 1, delta_time);
+}
+
+void EntityKernels::advance_animation(EntityStore *store, int index, float delta_time, float frame_duration)
+{
+    scalar_advance_animations(store, index, index + 1, delta_time, frame_duration);
+}
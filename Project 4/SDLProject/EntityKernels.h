@@ -0,0 +1,45 @@
+#pragma once
+#include "EntityStore.h"
+
+enum InstructionSet { SCALAR_INSTRUCTIONS, SSE2_INSTRUCTIONS, AVX2_INSTRUCTIONS, NEON_INSTRUCTIONS };
+
+// The per-step maths for a whole EntityStore, four or eight slots per instruction.
+// At start-up we pick the widest instruction set this CPU has (AVX2, then SSE2 on x86, NEON on
+// 64-bit ARM, plain C++ otherwise); select() overrides that, e.g. to compare them.
+//
+// Every version does the same operations in the same order without fusing any of them, so
+// they all produce exactly the same bits. The one-slot versions at the bottom are the plain
+// C++ ones, which is also what the batches fall back on for the slots left over at the end
+class EntityKernels {
+private:
+    static InstructionSet s_instruction_set;
+
+public:
+    static bool is_supported(InstructionSet instruction_set);
+    static bool select(InstructionSet instruction_set);
+    static InstructionSet get_instruction_set();
+    static const char *get_name(InstructionSet instruction_set);
+
+    // Whole-store batches, for stores big enough for the width to pay off (EntityStore::integrate
+    // and the benchmarks). The game itself only has a handful of entities and steps them one at
+    // a time with the versions at the bottom, since Entity::update runs their AI before moving
+    // them and resolves collisions between the y and x moves
+    //
+    // Velocity from movement times speed plus acceleration, which is where gravity comes in
+    static void integrate_velocity(EntityStore *store, float delta_time);
+    static void integrate_position(EntityStore *store, float delta_time);
+
+    // Moves each walk cycle on by delta_time, stepping to the next frame every frame_duration seconds.
+    // Only slots that have frames and are trying to move animate
+    static void advance_animations(EntityStore *store, float delta_time, float frame_duration);
+
+    // Sets hits[i] to 1 for every slot whose box overlaps the given one (touching doesn't count),
+    // and 0 otherwise. Returns how many hit. Filtering out ourselves, or inactive slots, is up to the caller
+    static int find_overlaps(EntityStore *store, float x, float y, float width, float height, unsigned char *hits);
+
+    // One slot at a time, split where Entity::update resolves collisions in between
+    static void integrate_velocity(EntityStore *store, int index, float delta_time);
+    static void integrate_position_x(EntityStore *store, int index, float delta_time);
+    static void integrate_position_y(EntityStore *store, int index, float delta_time);
+    static void advance_animation(EntityStore *store, int index, float delta_time, float frame_duration);
+};
@@ -0,0 +1,74 @@
+#include <algorithm>
+#include "EntityStore.h"
+#include "EntityKernels.h"
+
+int EntityStore::add(Entity *slot_owner)
+{
+    int index = get_count();
+    
+    // Everything starts at rest at the origin, like a freshly constructed Entity always has
+    position_x.push_back(0.0f);     position_y.push_back(0.0f);
+    previous_x.push_back(0.0f);     previous_y.push_back(0.0f);
+    velocity_x.push_back(0.0f);     velocity_y.push_back(0.0f);
+    acceleration_x.push_back(0.0f); acceleration_y.push_back(0.0f);
+    movement_x.push_back(0.0f);     movement_y.push_back(0.0f);
+    speed.push_back(0.0f);
+    
+    width.push_back(0.8f);
+    height.push_back(0.8f);
+    
+    animation_time.push_back(0.0f);
+    animation_index.push_back(0);
+    animation_frames.push_back(0);
+    
+    owner.push_back(slot_owner);
+    
+    return index;
+}
+
+void EntityStore::reserve(int capacity)
+{
+    position_x.reserve(capacity);     position_y.reserve(capacity);
+    previous_x.reserve(capacity);     previous_y.reserve(capacity);
+    velocity_x.reserve(capacity);     velocity_y.reserve(capacity);
+    acceleration_x.reserve(capacity); acceleration_y.reserve(capacity);
+    movement_x.reserve(capacity);     movement_y.reserve(capacity);
+    speed.reserve(capacity);
+    
+    width.reserve(capacity);
+    height.reserve(capacity);
+    
+    animation_time.reserve(capacity);
+    animation_index.reserve(capacity);
+    animation_frames.reserve(capacity);
+    
+    owner.reserve(capacity);
+}
+
+void EntityStore::clear()
+{
+    position_x.clear();     position_y.clear();
+    previous_x.clear();     previous_y.clear();
+    velocity_x.clear();     velocity_y.clear();
+    acceleration_x.clear(); acceleration_y.clear();
+    movement_x.clear();     movement_y.clear();
+    speed.clear();
+    
+    width.clear();
+    height.clear();
+    
+    animation_time.clear();
+    animation_index.clear();
+    animation_frames.clear();
+    
+    owner.clear();
+}
+
+void EntityStore::integrate(float delta_time)
+{
+    std::copy(position_x.begin(), position_x.end(), previous_x.begin());
+    std::copy(position_y.begin(), position_y.end(), previous_y.begin());
+    
+    EntityKernels::integrate_velocity(this, delta_time);
+    EntityKernels::integrate_position(this, delta_time);
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <vector>
+
+class Entity;
+
+// The fields that every fixed step reads and writes, kept as one array per component
+// instead of inside each Entity. Stepping lots of entities then walks a handful of
+// contiguous float arrays (which EntityKernels can do several at a time), rather than hopping
+// between big objects and dragging their matrices and animation pointers through the cache.
+//
+// Entities only hold their slot number, so the arrays are free to grow and move.
+// Slots are handed out in order and never given back; a level's entities live as long as the store
+class EntityStore {
+public:
+    // Kinematics, all 2D; the game never moves anything off z = 0
+    std::vector<float> position_x,     position_y;
+    std::vector<float> previous_x,     previous_y;  // Where the last fixed step started
+    std::vector<float> velocity_x,     velocity_y;
+    std::vector<float> acceleration_x, acceleration_y;
+    std::vector<float> movement_x,     movement_y;
+    std::vector<float> speed;
+    
+    // Collision boxes, centred on the position
+    std::vector<float> width, height;
+    
+    // Walk cycles. A slot with no frames doesn't animate
+    std::vector<float> animation_time;
+    std::vector<int>   animation_index;
+    std::vector<int>   animation_frames;
+    
+    // The Entity each slot belongs to, if any, so whatever finds slots (e.g. a broadphase) can get back to it
+    std::vector<Entity*> owner;
+    
+    // Methods
+    int  add(Entity *slot_owner = NULL);
+    void reserve(int capacity);
+    void clear();
+    
+    // Steps every slot at once: velocity from movement and acceleration, then position from velocity.
+    // Nothing here collides, so it's for things that don't need to (see Entity::update for those that do)
+    void integrate(float delta_time);
+    
+    // Getters
+    int const get_count() const { return (int) position_x.size(); }
+};
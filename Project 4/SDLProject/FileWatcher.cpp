@@ -0,0 +1,101 @@
+#include "FileWatcher.h"
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Room for a good batch of events at once; each one is a header plus the file name
+const int EVENT_BUFFER_SIZE = 4096;
+
+static time_t get_modified_time(const std::string &path)
+{
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return 0;
+    return info.st_mtime;
+}
+
+void FileWatcher::watch(const char *filepath)
+{
+    WatchedFile file;
+    file.path = filepath;
+    
+    size_t slash   = file.path.find_last_of('/');
+    file.directory = slash == std::string::npos ? "." : file.path.substr(0, slash);
+    file.name      = slash == std::string::npos ? file.path : file.path.substr(slash + 1);
+    file.modified_time = get_modified_time(file.path);
+    
+#ifdef __linux__
+    if (m_inotify == -1) m_inotify = inotify_init1(IN_NONBLOCK);
+    
+    // We watch the directory rather than the file: most editors save by writing a new file and
+    // renaming it over the old one, which a watch on the file itself would lose track of.
+    // Watching the same directory twice hands back the same descriptor
+    if (m_inotify != -1) file.watch_descriptor = inotify_add_watch(m_inotify, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+#endif
+    
+    m_files.push_back(file);
+}
+
+void FileWatcher::add_change(const std::string &path)
+{
+    // An editor can easily fire several events for one save
+    for (int i = 0; i < m_changed.size(); i++) if (m_changed[i] == path) return;
+    m_changed.push_back(path);
+}
+
+const std::vector<std::string> &FileWatcher::poll()
+{
+    m_changed.clear();
+    
+#ifdef __linux__
+    if (m_inotify != -1)
+    {
+        char buffer[EVENT_BUFFER_SIZE] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+        
+        ssize_t length;
+        while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *position = buffer; position < buffer + length; )
+            {
+                const struct inotify_event *event = (const struct inotify_event *) position;
+                
+                for (int i = 0; i < m_files.size(); i++)
+                {
+                    if (event->len > 0 && event->wd == m_files[i].watch_descriptor && m_files[i].name == event->name)
+                    {
+                        add_change(m_files[i].path);
+                    }
+                }
+                
+                position += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        
+        return m_changed;
+    }
+#endif
+    
+    for (int i = 0; i < m_files.size(); i++)
+    {
+        time_t modified_time = get_modified_time(m_files[i].path);
+        if (modified_time == m_files[i].modified_time) continue;
+        
+        m_files[i].modified_time = modified_time;
+        add_change(m_files[i].path);
+    }
+    
+    return m_changed;
+}
+
+void FileWatcher::cleanup()
+{
+#ifdef __linux__
+    // Closing the descriptor drops all of its watches with it
+    if (m_inotify != -1) close(m_inotify);
+    m_inotify = -1;
+#endif
+    
+    m_files.clear();
+}
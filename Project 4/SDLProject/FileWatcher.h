@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <time.h>
+
+// Tells us when files we care about (shaders, levels) change on disk, so the game can pick the
+// changes up without a restart. On Linux this is inotify; elsewhere (e.g. macOS) we fall back to
+// checking each file's modification time whenever we're polled
+class FileWatcher {
+private:
+    struct WatchedFile
+    {
+        std::string path;
+        std::string directory;
+        std::string name;
+        int    watch_descriptor = -1;
+        time_t modified_time    = 0;
+    };
+    
+    std::vector<WatchedFile> m_files;
+    std::vector<std::string> m_changed;  // Reused by every poll, so polling doesn't allocate
+    int m_inotify = -1;
+    
+    void add_change(const std::string &path);
+    
+public:
+    // Methods
+    void watch(const char *filepath);
+    
+    // Never blocks. Returns the watched paths that changed since the last poll
+    const std::vector<std::string> &poll();
+    void cleanup();
+};
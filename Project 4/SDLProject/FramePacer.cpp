@@ -0,0 +1,67 @@
+#include "FramePacer.h"
+#include <iostream>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+void FramePacer::initialise(double target_rate, bool use_vsync)
+{
+    m_frequency   = SDL_GetPerformanceFrequency();
+    m_clock_start = SDL_GetPerformanceCounter();
+    m_frame_start = m_clock_start;
+    
+    // Adaptive vsync (-1) lets a late frame go out straight away instead of waiting a whole
+    // extra refresh; not every driver has it, so plain vsync is the next best thing
+    m_is_vsynced = use_vsync && (SDL_GL_SetSwapInterval(-1) == 0 || SDL_GL_SetSwapInterval(1) == 0);
+    if (!m_is_vsynced) SDL_GL_SetSwapInterval(0);
+    
+    m_frame_length = (!m_is_vsynced && target_rate > 0.0) ? (Uint64) (m_frequency / target_rate) : 0;
+    
+    m_frame_count    = 0;
+    m_total_frame_ms = 0.0;
+    m_total_busy_ms  = 0.0;
+    m_worst_frame_ms = 0.0;
+}
+
+void FramePacer::end_frame()
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+    m_total_busy_ms += to_milliseconds(now - m_frame_start);
+    
+    Uint64 next_frame_start = now;
+    
+    if (m_frame_length > 0)
+    {
+        Uint64 deadline = m_frame_start + m_frame_length;
+        
+        // Sleeping gives the CPU back; spinning for the last stretch is what keeps us on time
+        while (now < deadline)
+        {
+            double remaining_ms = to_milliseconds(deadline - now);
+            if (remaining_ms > SPIN_MILLISECONDS) SDL_Delay((Uint32) (remaining_ms - SPIN_MILLISECONDS));
+            now = SDL_GetPerformanceCounter();
+        }
+        
+        // Counting the next frame from the deadline rather than from "now" stops small
+        // oversleeps from adding up. If we've fallen a whole frame behind, though, don't try to catch up
+        next_frame_start = now - deadline < m_frame_length ? deadline : now;
+    }
+    
+    double frame_ms = to_milliseconds(now - m_frame_start);
+    m_total_frame_ms += frame_ms;
+    if (frame_ms > m_worst_frame_ms) m_worst_frame_ms = frame_ms;
+    m_frame_count++;
+    
+    m_frame_start = next_frame_start;
+}
+
+void FramePacer::report() const
+{
+    if (m_frame_count == 0) return;
+    
+    double average_frame_ms = get_average_frame_ms();
+    
+    LOG("Paced " << m_frame_count << " frames" << (m_is_vsynced ? " on vsync" : "") << ": "
+        << average_frame_ms << " ms average (" << 1000.0 / average_frame_ms << " fps), "
+        << get_average_busy_ms() << " ms busy (" << 100.0 * get_average_busy_ms() / average_frame_ms << "%), "
+        << m_worst_frame_ms << " ms worst");
+}
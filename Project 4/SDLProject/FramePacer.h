@@ -0,0 +1,45 @@
+#pragma once
+#include <SDL.h>
+
+// Keeps the game loop from spinning flat out. Each frame either waits on vsync or, when that
+// isn't available, sleeps until the next frame is due. Also the game's clock: a high-resolution
+// counter in double precision, rather than whole milliseconds in a float
+class FramePacer {
+private:
+    Uint64 m_frequency    = 0;
+    Uint64 m_clock_start  = 0;
+    Uint64 m_frame_start  = 0;
+    Uint64 m_frame_length = 0;  // In counter ticks; 0 means we don't limit
+    bool   m_is_vsynced   = false;
+    
+    // Stats since initialise
+    int    m_frame_count     = 0;
+    double m_total_frame_ms  = 0.0;
+    double m_total_busy_ms   = 0.0;
+    double m_worst_frame_ms  = 0.0;
+    
+    double to_milliseconds(Uint64 ticks) const { return ticks * 1000.0 / m_frequency; }
+    
+public:
+    // SDL_Delay can overshoot by a scheduler tick, so we only sleep until this close to
+    // the deadline, and spin the rest of the way
+    static const int SPIN_MILLISECONDS = 2;
+    
+    // Methods
+    // A target_rate of 0 means as fast as we can go. With use_vsync, the swap does the waiting
+    // if the driver lets us turn it on, and target_rate is only the fallback
+    void initialise(double target_rate, bool use_vsync);
+    
+    // Call after the swap. Waits out whatever is left of the frame and records how long it took
+    void end_frame();
+    void report() const;
+    
+    // Getters
+    double get_time() const { return (SDL_GetPerformanceCounter() - m_clock_start) / (double) m_frequency; }
+    
+    bool   const is_vsynced()             const { return m_is_vsynced;  }
+    int    const get_frame_count()        const { return m_frame_count; }
+    double const get_average_frame_ms()   const { return m_frame_count > 0 ? m_total_frame_ms / m_frame_count : 0.0; }
+    double const get_average_busy_ms()    const { return m_frame_count > 0 ? m_total_busy_ms  / m_frame_count : 0.0; }
+    double const get_worst_frame_ms()     const { return m_worst_frame_ms; }
+};
@@ -0,0 +1,67 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <set>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// Runs the game without a display, for benchmarks and golden-frame tests on build machines.
+// Turned on from the command line:
+//
+//     --headless <frames>     draw this many frames into an offscreen framebuffer, then quit
+//     --dump <n>[,<n>...]     write these frames (counting from 1) out as frame_<n>.ppm
+//     --dump-dir <directory>  where the dumps go (defaults to the working directory)
+//     --timings <file>        also write every frame's time, one per line, in milliseconds
+//
+// Nothing in render() has to change: we bind our framebuffer once and leave it bound, so every
+// draw lands there, and the swap at the end of render() just has nothing to show
+class HeadlessTarget {
+private:
+    bool m_is_enabled   = false;
+    int  m_frame_limit  = 0;
+    int  m_frame_count  = 0;
+    int  m_width        = 0;
+    int  m_height       = 0;
+    
+    GLuint m_framebuffer  = 0;
+    GLuint m_renderbuffer = 0;
+    
+    std::set<int> m_dump_frames;
+    std::string   m_dump_directory = ".";
+    std::string   m_timings_filepath;
+    
+    Uint64 m_frame_start = 0;
+    std::vector<double> m_frame_times;  // Milliseconds, one per frame
+    
+    void dump_frame(int frame) const;
+    void report() const;
+    
+public:
+    static const int FRAMES_PER_SECOND = 60;
+    
+    // Has to come before SDL_Init, since it picks the video driver
+    void parse_arguments(int argc, char* argv[]);
+    
+    // Call once the GL context is current
+    void initialise(int width, int height);
+    
+    // Call after render(); finishes the frame's GL work so the timings mean something
+    void end_frame();
+    
+    // Prints the timing summary and frees the framebuffer
+    void cleanup();
+    
+    // Getters
+    bool   const is_enabled()       const { return m_is_enabled; }
+    bool   const is_finished()      const { return m_is_enabled && m_frame_count >= m_frame_limit; }
+    Uint32 const get_window_flags() const { return m_is_enabled ? SDL_WINDOW_HIDDEN : 0; }
+    
+    // Headless runs step a fixed 60 Hz clock instead of the real one, so the same frame
+    // always comes out the same no matter how fast the machine is
+    Uint32 const get_ticks() const { return m_is_enabled ? (Uint32) (m_frame_count * 1000 / FRAMES_PER_SECOND) : SDL_GetTicks(); }
+};
@@ -0,0 +1,162 @@
+#include <stddef.h>
+#include <algorithm>
+#include "InstancedSpriteRenderer.h"
+
+// Looked up at runtime, so a context that is missing either extension never calls into nothing
+typedef void (*VertexAttribDivisorFunction)(GLuint index, GLuint divisor);
+typedef void (*DrawArraysInstancedFunction)(GLenum mode, GLint first, GLsizei count, GLsizei instance_count);
+
+static VertexAttribDivisorFunction vertex_attrib_divisor = NULL;
+static DrawArraysInstancedFunction draw_arrays_instanced = NULL;
+
+void InstancedSpriteRenderer::initialise(ShaderProgram *program, StreamBuffer *stream_buffer)
+{
+    m_program       = program;
+    m_stream_buffer = stream_buffer;
+    m_max_instances = stream_buffer != NULL ? std::max((int) (stream_buffer->get_region_size() / sizeof(SpriteInstance)), 1) : 0;
+    
+    // Instancing came in with GL 3.3; on older contexts (like the macOS legacy one) we need two ARB
+    // extensions, one for the per-instance attributes and one for the instanced draw call
+    m_is_supported = false;
+    if (!SDL_GL_ExtensionSupported("GL_ARB_instanced_arrays") || !SDL_GL_ExtensionSupported("GL_ARB_draw_instanced")) return;
+    
+    vertex_attrib_divisor = (VertexAttribDivisorFunction) SDL_GL_GetProcAddress("glVertexAttribDivisorARB");
+    draw_arrays_instanced = (DrawArraysInstancedFunction) SDL_GL_GetProcAddress("glDrawArraysInstancedARB");
+    
+    m_is_supported = vertex_attrib_divisor != NULL && draw_arrays_instanced != NULL;
+    if (!m_is_supported) return;
+    
+    m_translation_attribute = glGetAttribLocation(program->programID, "instanceTranslation");
+    m_scale_attribute       = glGetAttribLocation(program->programID, "instanceScale");
+    m_frame_attribute       = glGetAttribLocation(program->programID, "instanceFrame");
+    m_atlas_size_uniform    = glGetUniformLocation(program->programID, "atlasSize");
+    m_atlas_region_uniform  = glGetUniformLocation(program->programID, "atlasRegion");
+    
+    // x, y, u, v for each corner, in the order of Quad.h so a triangle fan covers it
+    float quad[] =
+    {
+        -0.5f,  0.5f, 0.0f, 0.0f,
+        -0.5f, -0.5f, 0.0f, 1.0f,
+         0.5f, -0.5f, 1.0f, 1.0f,
+         0.5f,  0.5f, 1.0f, 0.0f
+    };
+    
+    glGenBuffers(1, &m_quad_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    
+    if (m_stream_buffer == NULL) glGenBuffers(1, &m_instance_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstancedSpriteRenderer::begin()
+{
+    flush();
+    
+    m_draw_calls     = 0;
+    m_instance_count = 0;
+}
+
+void InstancedSpriteRenderer::draw(GLuint texture_id, const AtlasRegion &texture_region, int atlas_cols, int atlas_rows, const glm::mat4 &model_matrix, int frame)
+{
+    // The sheet layout and region are uniforms, so they have to stay the same for a whole draw, just like the texture
+    bool same_region = texture_region.u     == m_texture_region.u     && texture_region.v      == m_texture_region.v &&
+                       texture_region.width == m_texture_region.width && texture_region.height == m_texture_region.height;
+    
+    // Past a stream buffer region's worth of instances, draw what we have and start again
+    bool is_full = m_max_instances > 0 && (int) m_instances.size() >= m_max_instances;
+    
+    if (texture_id != m_texture_id || !same_region || atlas_cols != m_atlas_cols || atlas_rows != m_atlas_rows || is_full) flush();
+    
+    m_texture_id     = texture_id;
+    m_texture_region = texture_region;
+    m_atlas_cols = atlas_cols;
+    m_atlas_rows = atlas_rows;
+    
+    // Pull the translation and scale straight out of the model matrix
+    SpriteInstance instance;
+    instance.x       = model_matrix[3][0];
+    instance.y       = model_matrix[3][1];
+    instance.scale_x = model_matrix[0][0];
+    instance.scale_y = model_matrix[1][1];
+    instance.frame   = (float) frame;
+    
+    m_instances.push_back(instance);
+    m_instance_count++;
+}
+
+void InstancedSpriteRenderer::flush()
+{
+    if (m_instances.empty() || !m_is_supported) return;
+    
+    RenderState::use_program(m_program);
+    glUniform2f(m_atlas_size_uniform, (float) m_atlas_cols, (float) m_atlas_rows);
+    glUniform4f(m_atlas_region_uniform, m_texture_region.u, m_texture_region.v, m_texture_region.width, m_texture_region.height);
+    
+    GLsizeiptr size    = m_instances.size() * sizeof(SpriteInstance);
+    GLintptr   offset  = 0;
+    
+    if (m_stream_buffer != NULL)
+    {
+        offset = m_stream_buffer->write(m_instances.data(), size);
+        if (offset == StreamBuffer::WRITE_FAILED)
+        {
+            m_instances.clear();
+            return;
+        }
+    }
+    else
+    {
+        // Orphan last flush's storage instead of waiting for the GPU to finish with it
+        glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+        glBufferData(GL_ARRAY_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_instances.data());
+    }
+    
+    GLsizei stride = sizeof(SpriteInstance);
+    
+    glVertexAttribPointer(m_translation_attribute, 2, GL_FLOAT, false, stride, (void *) (offset + offsetof(SpriteInstance, x)));
+    glVertexAttribPointer(m_scale_attribute,       2, GL_FLOAT, false, stride, (void *) (offset + offsetof(SpriteInstance, scale_x)));
+    glVertexAttribPointer(m_frame_attribute,       1, GL_FLOAT, false, stride, (void *) (offset + offsetof(SpriteInstance, frame)));
+    
+    // A divisor of 1 moves these attributes forward once per instance instead of once per vertex
+    GLint instance_attributes[] = { m_translation_attribute, m_scale_attribute, m_frame_attribute };
+    unsigned int attribute_mask = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        if (instance_attributes[i] < 0) continue;
+        vertex_attrib_divisor(instance_attributes[i], 1);
+        attribute_mask |= RenderState::attribute_bit(instance_attributes[i]);
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_quad_buffer);
+    glVertexAttribPointer(m_program->positionAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void *) 0);
+    glVertexAttribPointer(m_program->texCoordAttribute, 2, GL_FLOAT, false, 4 * sizeof(float), (void *) (2 * sizeof(float)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    RenderState::enable_attributes(attribute_mask | RenderState::attribute_bit(m_program->positionAttribute) |
+                                                    RenderState::attribute_bit(m_program->texCoordAttribute));
+    RenderState::bind_texture(m_texture_id);
+    draw_arrays_instanced(GL_TRIANGLE_FAN, 0, 4, (int) m_instances.size());
+    
+    // Attribute slots are shared with every other program, so put the divisors back
+    // The arrays themselves can stay enabled, the next enable_attributes call takes care of them
+    for (int i = 0; i < 3; i++)
+    {
+        if (instance_attributes[i] >= 0) vertex_attrib_divisor(instance_attributes[i], 0);
+    }
+    
+    m_instances.clear();
+    m_draw_calls++;
+}
+
+void InstancedSpriteRenderer::end()
+{
+    flush();
+}
+
+void InstancedSpriteRenderer::cleanup()
+{
+    glDeleteBuffers(1, &m_quad_buffer);
+    if (m_instance_buffer != 0) glDeleteBuffers(1, &m_instance_buffer);
+}
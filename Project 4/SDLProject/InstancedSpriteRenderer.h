@@ -0,0 +1,67 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "TextureAtlas.h"
+#include "RenderState.h"
+#include "StreamBuffer.h"
+
+// Everything the vertex shader needs to place and animate one sprite
+struct SpriteInstance
+{
+    float x, y;
+    float scale_x, scale_y;
+    float frame;
+};
+
+class InstancedSpriteRenderer {
+private:
+    ShaderProgram *m_program = NULL;
+    bool m_is_supported      = false;
+    
+    // The extra attributes and uniform that only shaders/vertex_instanced.glsl has
+    GLint m_translation_attribute = -1;
+    GLint m_scale_attribute       = -1;
+    GLint m_frame_attribute       = -1;
+    GLint m_atlas_size_uniform    = -1;
+    GLint m_atlas_region_uniform  = -1;
+    
+    // A single unit quad, drawn once per instance
+    GLuint m_quad_buffer     = 0;
+    GLuint m_instance_buffer = 0;  // Only when we weren't given a stream buffer
+    StreamBuffer *m_stream_buffer = NULL;
+    int m_max_instances = 0;  // How many fit in one stream buffer write; 0 for no limit
+    
+    // Instances waiting for the current texture and sprite sheet layout
+    std::vector<SpriteInstance> m_instances;
+    GLuint m_texture_id = 0;
+    AtlasRegion m_texture_region;
+    int    m_atlas_cols = 1;
+    int    m_atlas_rows = 1;
+    
+    // Stats for the current frame
+    int m_draw_calls     = 0;
+    int m_instance_count = 0;
+    
+public:
+    // Methods
+    void initialise(ShaderProgram *program, StreamBuffer *stream_buffer = NULL);
+    void begin();
+    void draw(GLuint texture_id, const AtlasRegion &texture_region, int atlas_cols, int atlas_rows, const glm::mat4 &model_matrix, int frame);
+    void flush();
+    void end();
+    void cleanup();
+    
+    // Getters
+    ShaderProgram * const get_program() const { return m_program; }
+    bool const is_supported()       const { return m_is_supported;   }
+    int  const get_draw_calls()     const { return m_draw_calls;     }
+    int  const get_instance_count() const { return m_instance_count; }
+};
@@ -1,26 +1,84 @@
 #include "Map.h"
 
-Map::Map(int width, int height, unsigned int *level_data, GLuint texture_id, float tile_size, int tile_count_x, int tile_count_y)
+// The legacy macOS context only offers vertex array objects through Apple's extension
+#ifdef __APPLE__
+#define glGenVertexArrays    glGenVertexArraysAPPLE
+#define glBindVertexArray    glBindVertexArrayAPPLE
+#define glDeleteVertexArrays glDeleteVertexArraysAPPLE
+#endif
+
+Map::Map(int width, int height, unsigned int *level_data, GLuint texture_id, float tile_size, int tile_count_x, int tile_count_y, AtlasRegion texture_region)
 {
     m_width = width;
     m_height = height;
     
     m_level_data = level_data;
     m_texture_id = texture_id;
+    m_texture_region = texture_region;
     
     m_tile_size = tile_size;
     m_tile_count_x = tile_count_x;
     m_tile_count_y = tile_count_y;
     
+    m_has_vertex_arrays = SDL_GL_ExtensionSupported("GL_ARB_vertex_array_object") ||
+                          SDL_GL_ExtensionSupported("GL_APPLE_vertex_array_object");
+    
     build();
 }
 
+Map::~Map()
+{
+    for (int i = 0; i < m_chunks.size(); i++)
+    {
+        glDeleteBuffers(1, &m_chunks[i].vertex_buffer);
+        glDeleteBuffers(1, &m_chunks[i].texture_coordinate_buffer);
+        if (m_has_vertex_arrays) glDeleteVertexArrays(1, &m_chunks[i].vertex_array);
+    }
+}
+
 void Map::build()
 {
+    // Round up, so the last row and column of chunks may be partly outside the level
+    m_chunk_count_x = (m_width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    m_chunk_count_y = (m_height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    
+    // We might be rebuilding after a change to the level data, so start from scratch
+    m_chunks.resize(m_chunk_count_x * m_chunk_count_y);
+    
+    for (int chunk_y = 0; chunk_y < m_chunk_count_y; chunk_y++)
+    {
+        for (int chunk_x = 0; chunk_x < m_chunk_count_x; chunk_x++) build_chunk(chunk_x, chunk_y);
+    }
+    
+    // The bounds are dependent on the size of the tiles
+    m_left_bound   = 0 - (m_tile_size / 2);
+    m_right_bound  = (m_tile_size * m_width) - (m_tile_size / 2);
+    m_top_bound    = 0 + (m_tile_size / 2);
+    m_bottom_bound = -(m_tile_size * m_height) + (m_tile_size / 2);
+}
+
+void Map::build_chunk(int chunk_x, int chunk_y)
+{
+    MapChunk &chunk = m_chunks[chunk_y * m_chunk_count_x + chunk_x];
+    
+    chunk.vertices.clear();
+    chunk.texture_coordinates.clear();
+    
+    // Start with an "inside out" box and grow it around every tile we find
+    chunk.left_bound   =  INFINITY;
+    chunk.right_bound  = -INFINITY;
+    chunk.top_bound    = -INFINITY;
+    chunk.bottom_bound =  INFINITY;
+    
+    int first_x = chunk_x * CHUNK_SIZE,
+        first_y = chunk_y * CHUNK_SIZE;
+    int last_x  = fmin(first_x + CHUNK_SIZE, m_width),
+        last_y  = fmin(first_y + CHUNK_SIZE, m_height);
+    
     // Since this is a 2D map, we need a nested for-loop
-    for(int y_coord = 0; y_coord < m_height; y_coord++)
+    for(int y_coord = first_y; y_coord < last_y; y_coord++)
     {
-        for(int x_coord = 0; x_coord < m_width; x_coord++)
+        for(int x_coord = first_x; x_coord < last_x; x_coord++)
         {
             // Get the current tile
             int tile = m_level_data[y_coord * m_width + x_coord];
@@ -36,54 +94,218 @@ void Map::build()
             float tile_width = 1.0f/ (float)  m_tile_count_x;
             float tile_height = 1.0f/ (float) m_tile_count_y;
             
-            float x_offset = -(m_tile_size / 2); // From center of tile
-            float y_offset =  (m_tile_size / 2); // From center of tile
+            // If the tileset lives in an atlas, squeeze those into the tileset's region
+            u_coord = m_texture_region.u + u_coord * m_texture_region.width;
+            v_coord = m_texture_region.v + v_coord * m_texture_region.height;
+            tile_width  *= m_texture_region.width;
+            tile_height *= m_texture_region.height;
+            
+            GLshort left   = (GLshort)  (x_coord - first_x),
+                    right  = (GLshort)  (left + 1),
+                    top    = (GLshort) -(y_coord - first_y),
+                    bottom = (GLshort)  (top - 1);
+            
+            GLushort u_left   = pack_texture_coordinate(u_coord),
+                     u_right  = pack_texture_coordinate(u_coord + tile_width),
+                     v_top    = pack_texture_coordinate(v_coord),
+                     v_bottom = pack_texture_coordinate(v_coord + tile_height);
             
             // So we can store them inside our std::vectors
-            m_vertices.insert(m_vertices.end(), {
-                x_offset + (m_tile_size * x_coord),  y_offset +  -m_tile_size * y_coord,
-                x_offset + (m_tile_size * x_coord),  y_offset + (-m_tile_size * y_coord) - m_tile_size,
-                x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset + (-m_tile_size * y_coord) - m_tile_size,
-                x_offset + (m_tile_size * x_coord), y_offset + -m_tile_size * y_coord,
-                x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset + (-m_tile_size * y_coord) - m_tile_size,
-                x_offset + (m_tile_size * x_coord) + m_tile_size, y_offset +  -m_tile_size * y_coord
+            chunk.vertices.insert(chunk.vertices.end(), {
+                left,  top,
+                left,  bottom,
+                right, bottom,
+                right, top
             });
             
-            m_texture_coordinates.insert(m_texture_coordinates.end(), {
-                u_coord, v_coord,
-                u_coord, v_coord + (tile_height),
-                u_coord + tile_width, v_coord + (tile_height),
-                u_coord, v_coord,
-                u_coord + tile_width, v_coord + (tile_height),
-                u_coord + tile_width, v_coord
+            chunk.texture_coordinates.insert(chunk.texture_coordinates.end(), {
+                u_left,  v_top,
+                u_left,  v_bottom,
+                u_right, v_bottom,
+                u_right, v_top
             });
+            
+            float x_offset = -(m_tile_size / 2); // From center of tile
+            float y_offset =  (m_tile_size / 2); // From center of tile
+            
+            chunk.left_bound   = fmin(chunk.left_bound,   x_offset + (m_tile_size * x_coord));
+            chunk.right_bound  = fmax(chunk.right_bound,  x_offset + (m_tile_size * x_coord) + m_tile_size);
+            chunk.top_bound    = fmax(chunk.top_bound,    y_offset + -m_tile_size * y_coord);
+            chunk.bottom_bound = fmin(chunk.bottom_bound, y_offset + (-m_tile_size * y_coord) - m_tile_size);
         }
     }
     
-    // The bounds are dependent on the size of the tiles
-    m_left_bound   = 0 - (m_tile_size / 2);
-    m_right_bound  = (m_tile_size * m_width) - (m_tile_size / 2);
-    m_top_bound    = 0 + (m_tile_size / 2);
-    m_bottom_bound = -(m_tile_size * m_height) + (m_tile_size / 2);
+    // Move the chunk's top-left corner to its place in the world and scale tiles up to tile size
+    chunk.model_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(m_tile_size * first_x - (m_tile_size / 2),
+                                                                    -m_tile_size * first_y + (m_tile_size / 2),
+                                                                    0.0f));
+    chunk.model_matrix = glm::scale(chunk.model_matrix, glm::vec3(m_tile_size, m_tile_size, 1.0f));
+    
+    chunk.quad_count = (int) chunk.vertices.size() / (2 * VERTICES_PER_QUAD);
+    chunk.is_dirty = true;
 }
 
-void Map::render(ShaderProgram *program)
+void Map::upload_chunk(MapChunk &chunk)
 {
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    program->SetModelMatrix(model_matrix);
+    if (chunk.vertex_buffer == 0)             glGenBuffers(1, &chunk.vertex_buffer);
+    if (chunk.texture_coordinate_buffer == 0) glGenBuffers(1, &chunk.texture_coordinate_buffer);
     
-    glUseProgram(program->programID);
+    // GL_STATIC_DRAW tells the driver we'll draw this many times but rarely touch it
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, chunk.vertices.size() * sizeof(GLshort), chunk.vertices.data(), GL_STATIC_DRAW);
     
-    glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, m_vertices.data());
-    glEnableVertexAttribArray(program->positionAttribute);
-    glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, m_texture_coordinates.data());
-    glEnableVertexAttribArray(program->texCoordAttribute);
+    glBindBuffer(GL_ARRAY_BUFFER, chunk.texture_coordinate_buffer);
+    glBufferData(GL_ARRAY_BUFFER, chunk.texture_coordinates.size() * sizeof(GLushort), chunk.texture_coordinates.data(), GL_STATIC_DRAW);
     
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    chunk.is_dirty = false;
+}
+
+void Map::set_tile(int x_coord, int y_coord, unsigned int tile)
+{
+    if (x_coord < 0 || x_coord >= m_width)  return;
+    if (y_coord < 0 || y_coord >= m_height) return;
+    if (m_level_data[y_coord * m_width + x_coord] == tile) return;
+    
+    m_level_data[y_coord * m_width + x_coord] = tile;
+    
+    // Only the chunk holding the tile needs a new mesh; it gets re-uploaded the next time we render
+    build_chunk(x_coord / CHUNK_SIZE, y_coord / CHUNK_SIZE);
+}
+
+int Map::set_tiles(const unsigned int *level_data)
+{
+    // Copy over only the tiles that differ, and note which chunks they land in,
+    // so a small edit to a big level doesn't rebuild every mesh
+    std::vector<bool> is_chunk_changed(m_chunks.size(), false);
+    
+    for (int y_coord = 0; y_coord < m_height; y_coord++)
+    {
+        for (int x_coord = 0; x_coord < m_width; x_coord++)
+        {
+            int tile_index = y_coord * m_width + x_coord;
+            if (m_level_data[tile_index] == level_data[tile_index]) continue;
+            
+            m_level_data[tile_index] = level_data[tile_index];
+            is_chunk_changed[(y_coord / CHUNK_SIZE) * m_chunk_count_x + x_coord / CHUNK_SIZE] = true;
+        }
+    }
+    
+    int rebuilt_chunks = 0;
+    for (int chunk_y = 0; chunk_y < m_chunk_count_y; chunk_y++)
+    {
+        for (int chunk_x = 0; chunk_x < m_chunk_count_x; chunk_x++)
+        {
+            if (!is_chunk_changed[chunk_y * m_chunk_count_x + chunk_x]) continue;
+            
+            build_chunk(chunk_x, chunk_y);
+            rebuilt_chunks++;
+        }
+    }
+    
+    return rebuilt_chunks;
+}
+
+void Map::render(ShaderProgram *program, const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix)
+{
+    RenderState::use_program(program);
+    RenderState::bind_texture(m_texture_id);
+    
+    // Work out which part of the world the camera sees by taking the corners of the
+    // screen back through the projection and view matrices
+    glm::mat4 inverse_view_projection = glm::inverse(projection_matrix * view_matrix);
+    glm::vec4 corner_a = inverse_view_projection * glm::vec4(-1.0f, -1.0f, 0.0f, 1.0f);
+    glm::vec4 corner_b = inverse_view_projection * glm::vec4( 1.0f,  1.0f, 0.0f, 1.0f);
+    
+    float view_left   = fmin(corner_a.x, corner_b.x),
+          view_right  = fmax(corner_a.x, corner_b.x),
+          view_bottom = fmin(corner_a.y, corner_b.y),
+          view_top    = fmax(corner_a.y, corner_b.y);
+    
+    // Rather than testing every chunk, go straight to the ones under the view,
+    // so the cost doesn't depend on how big the level is
+    float chunk_extent = m_tile_size * CHUNK_SIZE;
+    int first_chunk_x = floor((view_left  - m_left_bound) / chunk_extent),
+        last_chunk_x  = floor((view_right - m_left_bound) / chunk_extent),
+        first_chunk_y = floor((m_top_bound - view_top)    / chunk_extent),
+        last_chunk_y  = floor((m_top_bound - view_bottom) / chunk_extent);
+    
+    first_chunk_x = fmax(first_chunk_x, 0);
+    first_chunk_y = fmax(first_chunk_y, 0);
+    last_chunk_x  = fmin(last_chunk_x, m_chunk_count_x - 1);
+    last_chunk_y  = fmin(last_chunk_y, m_chunk_count_y - 1);
+    
+    m_visible_chunk_count = 0;
+    
+    for (int chunk_y = first_chunk_y; chunk_y <= last_chunk_y; chunk_y++)
+    {
+        for (int chunk_x = first_chunk_x; chunk_x <= last_chunk_x; chunk_x++)
+        {
+            MapChunk &chunk = m_chunks[chunk_y * m_chunk_count_x + chunk_x];
+            
+            // Empty chunks, or chunks whose tiles all sit outside the view, can be skipped
+            if (chunk.quad_count == 0) continue;
+            if (chunk.right_bound < view_left || chunk.left_bound   > view_right) continue;
+            if (chunk.bottom_bound > view_top || chunk.top_bound    < view_bottom) continue;
+            
+            render_chunk(chunk, program);
+            m_visible_chunk_count++;
+        }
+    }
+    
+    if (m_has_vertex_arrays) glBindVertexArray(0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void Map::render_chunk(MapChunk &chunk, ShaderProgram *program)
+{
+    if (chunk.is_dirty) upload_chunk(chunk);
+    
+    program->SetModelMatrix(chunk.model_matrix);
+    
+    bool has_attributes = chunk.bound_position_attribute  == (GLint) program->positionAttribute &&
+                          chunk.bound_tex_coord_attribute == (GLint) program->texCoordAttribute;
+    
+    if (m_has_vertex_arrays)
+    {
+        if (chunk.vertex_array == 0) glGenVertexArrays(1, &chunk.vertex_array);
+        glBindVertexArray(chunk.vertex_array);
+    }
+    
+    // With a vertex array object the attribute setup is remembered, so we only redo it when
+    // the program's attribute locations change; without one we have to redo it every time
+    if (!m_has_vertex_arrays || !has_attributes)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.vertex_buffer);
+        glVertexAttribPointer(program->positionAttribute, 2, GL_SHORT, false, 0, 0);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, chunk.texture_coordinate_buffer);
+        glVertexAttribPointer(program->texCoordAttribute, 2, GL_UNSIGNED_SHORT, true, 0, 0);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        
+        // Inside a vertex array object the enabled arrays belong to the object, not to the
+        // global state RenderState keeps track of
+        if (m_has_vertex_arrays)
+        {
+            glEnableVertexAttribArray(program->positionAttribute);
+            glEnableVertexAttribArray(program->texCoordAttribute);
+        }
+        else
+        {
+            RenderState::enable_attributes(RenderState::attribute_bit(program->positionAttribute) |
+                                           RenderState::attribute_bit(program->texCoordAttribute));
+        }
+        
+        // The index buffer binding is part of the vertex array object too
+        QuadIndexBuffer::bind();
+        
+        chunk.bound_position_attribute  = program->positionAttribute;
+        chunk.bound_tex_coord_attribute = program->texCoordAttribute;
+    }
     
-    glDrawArrays(GL_TRIANGLES, 0, (int) m_vertices.size() / 2);
-    glDisableVertexAttribArray(program->positionAttribute);
-    glDisableVertexAttribArray(program->texCoordAttribute);
+    glDrawElements(GL_TRIANGLES, chunk.quad_count * INDICES_PER_QUAD, GL_UNSIGNED_SHORT, 0);
 }
 
 bool Map::is_solid(glm::vec3 position, float *penetration_x, float *penetration_y)
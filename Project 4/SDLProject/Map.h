@@ -12,6 +12,34 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "Quad.h"
+#include "TextureAtlas.h"
+#include "RenderState.h"
+
+// A fixed-size block of the map with its own mesh, so we can skip the ones the camera can't see
+struct MapChunk
+{
+    // Four corners per tile (see Quad.h). Positions are whole tiles counted from the chunk's
+    // top-left corner, and model_matrix turns them back into world space. With two GLshorts of
+    // position and two GLushorts of texture coordinate a corner, a tile is 32 bytes, where six
+    // corners of four floats each took 96
+    std::vector<GLshort>  vertices;
+    std::vector<GLushort> texture_coordinates;
+    glm::mat4 model_matrix;
+    
+    GLuint vertex_buffer             = 0;
+    GLuint texture_coordinate_buffer = 0;
+    GLuint vertex_array              = 0;
+    bool   is_dirty                  = true;
+    int    quad_count                = 0;
+    
+    // The attribute locations that vertex_array was set up with
+    GLint bound_position_attribute  = -1;
+    GLint bound_tex_coord_attribute = -1;
+    
+    // World-space box around the chunk's solid tiles
+    float left_bound, right_bound, top_bound, bottom_bound;
+};
 
 class Map {
 private:
@@ -21,27 +49,45 @@ private:
     // Here, the level_data is the numerical "drawing" of the map
     unsigned int *m_level_data;
     GLuint m_texture_id;
+    AtlasRegion m_texture_region; // Where the tileset sits if m_texture_id is an atlas
     
     float m_tile_size;
     int   m_tile_count_x;
     int   m_tile_count_y;
     
     // Just like with rendering text, we're rendering several sprites at once
-    // So we need vectors to store their respective vertices and texture coordinates
-    std::vector<float> m_vertices;
-    std::vector<float> m_texture_coordinates;
+    // So every chunk keeps vectors of its vertices and texture coordinates, plus a copy
+    // of them on the GPU that only gets re-uploaded when its tiles change (see set_tile)
+    std::vector<MapChunk> m_chunks;
+    int  m_chunk_count_x = 0;
+    int  m_chunk_count_y = 0;
+    bool m_has_vertex_arrays = false;
+    
+    // How many chunks made it past culling during the last render
+    int m_visible_chunk_count = 0;
     
     // The boundaries of the map
     float m_left_bound, m_right_bound, m_top_bound, m_bottom_bound;
     
+    void build_chunk(int chunk_x, int chunk_y);
+    void upload_chunk(MapChunk &chunk);
+    void render_chunk(MapChunk &chunk, ShaderProgram *program);
+    
 public:
+    // Size of a chunk, in tiles, along each axis
+    static const int CHUNK_SIZE = 32;
+    
     // Constructor
     Map(int width, int height, unsigned int *level_data, GLuint texture_id, float tile_size, int
-    tile_count_x, int tile_count_y);
+    tile_count_x, int tile_count_y, AtlasRegion texture_region = AtlasRegion());
+    
+    ~Map();
     
     // Methods
     void build();
-    void render(ShaderProgram *program);
+    void render(ShaderProgram *program, const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix);
+    void set_tile(int x_coord, int y_coord, unsigned int tile);
+    int  set_tiles(const unsigned int *level_data);  // Whole level's worth; returns how many chunks it rebuilt
     bool is_solid(glm::vec3 position, float *penetration_x, float *penetration_y);
     
     // Getters
@@ -55,8 +101,12 @@ public:
     int   const get_tile_count_x() const { return m_tile_count_x; }
     int   const get_tile_count_y() const { return m_tile_count_y; }
     
-    std::vector<float> const get_vertices()            const { return m_vertices;             }
-    std::vector<float> const get_texture_coordinates() const { return m_texture_coordinates; }
+    int             const get_chunk_count()         const { return (int) m_chunks.size(); }
+    int             const get_visible_chunk_count() const { return m_visible_chunk_count; }
+    MapChunk const &      get_chunk(int index)      const { return m_chunks[index];       }
+    
+    std::vector<GLshort>  const &get_vertices(int chunk_index)            const { return m_chunks[chunk_index].vertices;            }
+    std::vector<GLushort> const &get_texture_coordinates(int chunk_index) const { return m_chunks[chunk_index].texture_coordinates; }
     
     float const get_left_bound()   const { return m_left_bound;   }
     float const get_right_bound()  const { return m_right_bound;  }
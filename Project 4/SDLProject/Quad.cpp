@@ -0,0 +1,37 @@
+#include "Quad.h"
+#include <vector>
+
+GLuint QuadIndexBuffer::s_buffer = 0;
+
+void QuadIndexBuffer::bind()
+{
+    if (s_buffer != 0)
+    {
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_buffer);
+        return;
+    }
+    
+    // The pattern is the same for every quad, only shifted by four vertices each time,
+    // so we build it once for the largest quad count anyone can ask for
+    std::vector<GLushort> indices;
+    indices.reserve(MAX_QUADS * INDICES_PER_QUAD);
+    
+    for (int quad = 0; quad < MAX_QUADS; quad++)
+    {
+        GLushort first = (GLushort) (quad * VERTICES_PER_QUAD);
+        indices.insert(indices.end(), {
+            first, (GLushort) (first + 1), (GLushort) (first + 2),
+            first, (GLushort) (first + 2), (GLushort) (first + 3)
+        });
+    }
+    
+    glGenBuffers(1, &s_buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, s_buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data(), GL_STATIC_DRAW);
+}
+
+void QuadIndexBuffer::cleanup()
+{
+    glDeleteBuffers(1, &s_buffer);
+    s_buffer = 0;
+}
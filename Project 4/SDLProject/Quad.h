@@ -0,0 +1,45 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <math.h>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// Every quad we draw (tiles, sprites, glyphs) is four corners in this order:
+//
+//   0 ---- 3
+//   |    / |
+//   |  /   |
+//   1 ---- 2
+//
+// and the two triangles (0, 1, 2) and (0, 2, 3) come from one index buffer that everyone shares
+const int VERTICES_PER_QUAD = 4;
+const int INDICES_PER_QUAD  = 6;
+
+// A sprite corner that has already been moved into world space
+struct SpriteVertex
+{
+    float x, y;
+    GLushort u, v;
+};
+
+// Texture coordinates go from 0.0 to 1.0, so we store them as normalised 16-bit integers
+inline GLushort pack_texture_coordinate(float coordinate)
+{
+    return (GLushort) roundf(fminf(fmaxf(coordinate, 0.0f), 1.0f) * 65535.0f);
+}
+
+class QuadIndexBuffer {
+private:
+    static GLuint s_buffer;
+    
+public:
+    // 16-bit indices can only reach 65536 vertices
+    static const int MAX_QUADS = 65536 / VERTICES_PER_QUAD;
+    
+    static void bind();
+    static void cleanup();
+};
@@ -0,0 +1,178 @@
+#include "RenderQueue.h"
+#include "Entity.h"
+#include "Map.h"
+#include "TextMesh.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+const int RADIX_BITS    = 8,
+          RADIX_BUCKETS = 1 << RADIX_BITS,
+          RADIX_PASSES  = 64 / RADIX_BITS;
+
+const float DEPTH_ORIGIN         = 32768.0f,
+            DEPTH_STEPS_PER_UNIT = 64.0f;
+
+uint64_t RenderQueue::make_sort_key(int layer, int program_index, int texture_index, GLushort depth)
+{
+    return ((uint64_t) (layer         & 0xFF)   << 56) |
+           ((uint64_t) (program_index & 0xFF)   << 48) |
+           ((uint64_t) (texture_index & 0xFFFF) << 32) |
+           ((uint64_t) depth                    << 16);
+}
+
+GLushort RenderQueue::get_depth(float y)
+{
+    float depth = DEPTH_ORIGIN - y * DEPTH_STEPS_PER_UNIT;
+    return (GLushort) std::min(std::max(depth, 0.0f), 65535.0f);
+}
+
+// A frame only uses a handful of programs and textures, so a linear search beats a map here
+int RenderQueue::get_index(std::vector<GLuint> &ids, GLuint id, int limit)
+{
+    for (int i = 0; i < (int) ids.size(); i++)
+    {
+        if (ids[i] == id) return i;
+    }
+    
+    if ((int) ids.size() == limit)
+    {
+        LOG("Render queue can't tell more than " << limit << " programs or textures apart in one frame.");
+        assert(false);
+        return limit - 1;
+    }
+    
+    ids.push_back(id);
+    return (int) ids.size() - 1;
+}
+
+void RenderQueue::begin(SpriteBatch *batch, InstancedSpriteRenderer *instanced_renderer, const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix)
+{
+    // clear() keeps the storage, so after the first few frames pushing never allocates
+    m_commands.clear();
+    m_program_ids.clear();
+    m_texture_ids.clear();
+    
+    m_batch              = batch;
+    m_instanced_renderer = instanced_renderer;
+    m_view_matrix        = view_matrix;
+    m_projection_matrix  = projection_matrix;
+}
+
+void RenderQueue::push(RenderCommandType type, ShaderProgram *program, GLuint texture_id, int layer, GLushort depth, Entity *entity, Map *map, TextMesh *text)
+{
+    RenderCommand command;
+    command.sort_key = make_sort_key(layer, get_index(m_program_ids, program->programID, MAX_PROGRAMS),
+                                            get_index(m_texture_ids, texture_id,         MAX_TEXTURES), depth);
+    command.type     = type;
+    command.program  = program;
+    command.entity   = entity;
+    command.map      = map;
+    command.text     = text;
+    
+    m_commands.push_back(command);
+}
+
+void RenderQueue::push_sprite(Entity *entity, int layer)
+{
+    // The model matrix already holds where the entity is drawn this frame, interpolation and all
+    push(SPRITE_COMMAND, m_batch->get_program(), entity->m_texture_id, layer, get_depth(entity->m_model_matrix[3][1]), entity, NULL, NULL);
+}
+
+void RenderQueue::push_instanced_sprite(Entity *entity, int layer)
+{
+    push(INSTANCED_SPRITE_COMMAND, m_instanced_renderer->get_program(), entity->m_texture_id, layer, get_depth(entity->m_model_matrix[3][1]), entity, NULL, NULL);
+}
+
+void RenderQueue::push_map(Map *map, ShaderProgram *program, int layer)
+{
+    push(MAP_COMMAND, program, map->get_texture_id(), layer, 0, NULL, map, NULL);
+}
+
+void RenderQueue::push_text(TextMesh *text, ShaderProgram *program, int layer)
+{
+    push(TEXT_COMMAND, program, text->get_texture_id(), layer, 0, NULL, NULL, text);
+}
+
+void RenderQueue::sort()
+{
+    // Least significant digit radix sort, one byte at a time. Each pass is stable, so
+    // commands with the same key keep the order they were pushed in
+    int count = (int) m_commands.size();
+    m_sorted.resize(count);
+    
+    for (int pass = 0; pass < RADIX_PASSES; pass++)
+    {
+        int shift = pass * RADIX_BITS;
+        int bucket_counts[RADIX_BUCKETS] = { 0 };
+        
+        for (int i = 0; i < count; i++) bucket_counts[(m_commands[i].sort_key >> shift) & (RADIX_BUCKETS - 1)]++;
+        
+        // Every command shares this byte (always true for the unused low bits), so the pass would change nothing
+        if (bucket_counts[(m_commands[0].sort_key >> shift) & (RADIX_BUCKETS - 1)] == count) continue;
+        
+        int offset = 0;
+        for (int bucket = 0; bucket < RADIX_BUCKETS; bucket++)
+        {
+            int bucket_count      = bucket_counts[bucket];
+            bucket_counts[bucket] = offset;
+            offset               += bucket_count;
+        }
+        
+        for (int i = 0; i < count; i++)
+        {
+            int bucket = (m_commands[i].sort_key >> shift) & (RADIX_BUCKETS - 1);
+            m_sorted[bucket_counts[bucket]++] = m_commands[i];
+        }
+        
+        m_commands.swap(m_sorted);
+    }
+}
+
+void RenderQueue::submit()
+{
+    if (m_commands.empty()) return;
+    
+    sort();
+    
+    // The batch and the instanced renderer both hold on to their sprites until they're flushed,
+    // so whichever one was in use has to flush before anything else draws
+    RenderCommandType previous_type = m_commands[0].type;
+    
+    for (int i = 0; i < m_commands.size(); i++)
+    {
+        RenderCommand &command = m_commands[i];
+        
+        if (command.type != previous_type)
+        {
+            if (previous_type == SPRITE_COMMAND)           m_batch->flush();
+            if (previous_type == INSTANCED_SPRITE_COMMAND) m_instanced_renderer->flush();
+            previous_type = command.type;
+        }
+        
+        switch (command.type)
+        {
+            case SPRITE_COMMAND:
+                command.entity->render(m_batch);
+                break;
+                
+            case INSTANCED_SPRITE_COMMAND:
+                command.entity->render_instanced(m_instanced_renderer);
+                break;
+                
+            case MAP_COMMAND:
+                command.map->render(command.program, m_view_matrix, m_projection_matrix);
+                break;
+                
+            case TEXT_COMMAND:
+                command.text->render(command.program);
+                break;
+        }
+    }
+    
+    m_batch->flush();
+    m_instanced_renderer->flush();
+    m_commands.clear();
+}
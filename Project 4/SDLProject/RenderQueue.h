@@ -0,0 +1,85 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <stdint.h>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteRenderer.h"
+
+class Entity;
+class Map;
+class TextMesh;
+
+// Layers always draw in this order, back to front, whatever their shader or texture
+enum RenderLayer        { MAP_LAYER, ENTITY_LAYER, TEXT_LAYER };
+enum RenderCommandType  { SPRITE_COMMAND, INSTANCED_SPRITE_COMMAND, MAP_COMMAND, TEXT_COMMAND };
+
+struct RenderCommand
+{
+    // From the most significant bits down:
+    //   layer (8) | shader (8) | texture (16) | depth (16) | unused (16)
+    // so sorting by key groups everything by layer first, then by state inside each layer.
+    // Shader and texture are numbered in the order the frame first uses them rather than by
+    // their GL names, which can be any size and would collide once cut down to fit. Depth puts
+    // the sprites sharing a shader and texture back to front (see get_depth); draws that share
+    // all four keep the order they were pushed in
+    uint64_t sort_key;
+    
+    RenderCommandType type;
+    ShaderProgram *program;
+    
+    // Only the one matching the type is set
+    Entity   *entity;
+    Map      *map;
+    TextMesh *text;
+};
+
+// Collects a frame's draws, sorts them so that draws sharing a shader and texture end up
+// next to each other, and then hands them to the sprite batch, the instanced renderer, or
+// draws them directly
+class RenderQueue {
+private:
+    std::vector<RenderCommand> m_commands;
+    std::vector<RenderCommand> m_sorted;  // Scratch space for the radix sort
+    
+    // This frame's programs and textures, in the order they were first pushed
+    std::vector<GLuint> m_program_ids;
+    std::vector<GLuint> m_texture_ids;
+    
+    SpriteBatch             *m_batch              = NULL;
+    InstancedSpriteRenderer *m_instanced_renderer = NULL;
+    glm::mat4 m_view_matrix, m_projection_matrix;
+    
+    void push(RenderCommandType type, ShaderProgram *program, GLuint texture_id, int layer, GLushort depth, Entity *entity, Map *map, TextMesh *text);
+    void sort();
+    
+    static int get_index(std::vector<GLuint> &ids, GLuint id, int limit);
+    
+public:
+    static const int MAX_PROGRAMS = 1 << 8,
+                     MAX_TEXTURES = 1 << 16;
+    
+    static uint64_t make_sort_key(int layer, int program_index, int texture_index, GLushort depth);
+    
+    // Sprites lower down the screen are drawn later, so they overlap the ones behind them.
+    // y is quantised to 1/64 of a unit around the origin, which covers 512 units either way
+    static GLushort get_depth(float y);
+    
+    // Methods
+    void begin(SpriteBatch *batch, InstancedSpriteRenderer *instanced_renderer, const glm::mat4 &view_matrix, const glm::mat4 &projection_matrix);
+    void push_sprite(Entity *entity, int layer);
+    void push_instanced_sprite(Entity *entity, int layer);
+    void push_map(Map *map, ShaderProgram *program, int layer);
+    void push_text(TextMesh *text, ShaderProgram *program, int layer);
+    void submit();
+    
+    // Getters
+    int const get_command_count() const { return (int) m_commands.size(); }
+};
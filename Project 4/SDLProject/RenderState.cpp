@@ -0,0 +1,93 @@
+#include "RenderState.h"
+
+GLuint       RenderState::s_texture_id        = 0;
+unsigned int RenderState::s_attribute_mask    = 0;
+bool         RenderState::s_blend_enabled     = false;
+GLenum       RenderState::s_blend_source      = GL_ONE;
+GLenum       RenderState::s_blend_destination = GL_ZERO;
+
+bool RenderState::s_has_texture    = false;
+bool RenderState::s_has_attributes = false;
+bool RenderState::s_has_blend      = false;
+
+int RenderState::s_transitions = 0;
+int RenderState::s_skipped     = 0;
+
+// GL only guarantees 16 generic attributes
+const int MAX_ATTRIBUTES = 16;
+
+void RenderState::use_program(ShaderProgram *program)
+{
+    program->Use();
+}
+
+void RenderState::bind_texture(GLuint texture_id)
+{
+    if (s_has_texture && s_texture_id == texture_id)
+    {
+        s_skipped++;
+        return;
+    }
+    
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    s_texture_id  = texture_id;
+    s_has_texture = true;
+    s_transitions++;
+}
+
+void RenderState::enable_attributes(unsigned int mask)
+{
+    // Without a known starting point, every slot has to be set explicitly once
+    unsigned int changed = s_has_attributes ? s_attribute_mask ^ mask : (1u << MAX_ATTRIBUTES) - 1;
+    
+    for (int location = 0; location < MAX_ATTRIBUTES; location++)
+    {
+        unsigned int bit = attribute_bit(location);
+        if (!(changed & bit))
+        {
+            if (mask & bit) s_skipped++;
+            continue;
+        }
+        
+        if (mask & bit) glEnableVertexAttribArray(location);
+        else            glDisableVertexAttribArray(location);
+        s_transitions++;
+    }
+    
+    s_attribute_mask = mask;
+    s_has_attributes = true;
+}
+
+void RenderState::set_blend(bool enabled, GLenum source, GLenum destination)
+{
+    if (!s_has_blend || s_blend_enabled != enabled)
+    {
+        if (enabled) glEnable(GL_BLEND);
+        else         glDisable(GL_BLEND);
+        s_blend_enabled = enabled;
+        s_transitions++;
+    }
+    else s_skipped++;
+    
+    if (!s_has_blend || s_blend_source != source || s_blend_destination != destination)
+    {
+        glBlendFunc(source, destination);
+        s_blend_source      = source;
+        s_blend_destination = destination;
+        s_transitions++;
+    }
+    else s_skipped++;
+    
+    s_has_blend = true;
+}
+
+void RenderState::invalidate()
+{
+    s_has_texture = s_has_attributes = s_has_blend = false;
+}
+
+void RenderState::reset_counters()
+{
+    s_transitions = 0;
+    s_skipped     = 0;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "ShaderProgram.h"
+
+// Remembers the GL state that every draw touches (program, texture, enabled attribute arrays
+// and blending) and only talks to the driver when something actually changes.
+// Everything outside of a vertex array object should go through here, or the cached values
+// won't match what GL really has bound
+class RenderState {
+private:
+    static GLuint       s_texture_id;
+    static unsigned int s_attribute_mask;
+    static bool         s_blend_enabled;
+    static GLenum       s_blend_source;
+    static GLenum       s_blend_destination;
+    
+    // False until the first call, and again after invalidate(), so the next call always goes through
+    static bool s_has_texture;
+    static bool s_has_attributes;
+    static bool s_has_blend;
+    
+    static int s_transitions;
+    static int s_skipped;
+    
+public:
+    static void use_program(ShaderProgram *program);
+    static void bind_texture(GLuint texture_id);
+    
+    // Leaves exactly the attribute arrays in the mask enabled (see attribute_bit)
+    static void enable_attributes(unsigned int mask);
+    static void set_blend(bool enabled, GLenum source = GL_SRC_ALPHA, GLenum destination = GL_ONE_MINUS_SRC_ALPHA);
+    
+    // For when someone else has been changing state behind our back (e.g. deleting a texture,
+    // which quietly unbinds it)
+    static void invalidate();
+    
+    // Per-frame counts of GL state calls issued and avoided. Program binds are counted by
+    // ShaderProgram itself
+    static void reset_counters();
+    static int  get_transitions() { return s_transitions; }
+    static int  get_skipped()     { return s_skipped;     }
+    
+    // Locations come straight from glGetAttribLocation, which gives -1 for an attribute the
+    // shader doesn't use (or the compiler optimised out); those have no bit
+    static unsigned int attribute_bit(GLint location) { return location < 0 ? 0 : 1u << location; }
+};
@@ -0,0 +1,170 @@
+#include <math.h>
+#include <algorithm>
+#include "SpatialGrid.h"
+
+void SpatialGrid::initialise(float cell_size)
+{
+    m_cell_size = cell_size;
+    clear();
+}
+
+void SpatialGrid::clear()
+{
+    m_cells.clear();
+    m_free_cells.clear();
+    m_cell_lookup.clear();
+    m_ranges.clear();
+    m_refiled_count = 0;
+}
+
+SpatialGrid::CellRange SpatialGrid::get_range(float left, float bottom, float right, float top) const
+{
+    CellRange range;
+    range.min_x = (int) floorf(left   / m_cell_size);
+    range.min_y = (int) floorf(bottom / m_cell_size);
+    range.max_x = (int) floorf(right  / m_cell_size);
+    range.max_y = (int) floorf(top    / m_cell_size);
+    return range;
+}
+
+void SpatialGrid::insert(int slot, const CellRange &range)
+{
+    for (int y = range.min_y; y <= range.max_y; y++)
+    {
+        for (int x = range.min_x; x <= range.max_x; x++)
+        {
+            std::unordered_map<uint64_t, int>::iterator found = m_cell_lookup.find(get_key(x, y));
+            if (found != m_cell_lookup.end())
+            {
+                m_cells[found->second].slots.push_back(slot);
+                continue;
+            }
+    
+            int index;
+            if (m_free_cells.empty())
+            {
+                index = (int) m_cells.size();
+                m_cells.push_back(Cell());
+            }
+            else
+            {
+                index = m_free_cells.back();
+                m_free_cells.pop_back();
+            }
+    
+            m_cells[index].x = x;
+            m_cells[index].y = y;
+            m_cells[index].slots.push_back(slot);
+            m_cell_lookup[get_key(x, y)] = index;
+        }
+    }
+}
+
+void SpatialGrid::remove(int slot, const CellRange &range)
+{
+    for (int y = range.min_y; y <= range.max_y; y++)
+    {
+        for (int x = range.min_x; x <= range.max_x; x++)
+        {
+            std::unordered_map<uint64_t, int>::iterator found = m_cell_lookup.find(get_key(x, y));
+            if (found == m_cell_lookup.end()) continue;
+    
+            // Order within a cell doesn't matter, so swap the last one into the gap
+            std::vector<int> &slots = m_cells[found->second].slots;
+            std::vector<int>::iterator position = std::find(slots.begin(), slots.end(), slot);
+            if (position == slots.end()) continue;
+    
+            *position = slots.back();
+            slots.pop_back();
+    
+            // Otherwise a wandering crowd leaves a trail of empty cells behind it
+            if (slots.empty())
+            {
+                m_free_cells.push_back(found->second);
+                m_cell_lookup.erase(found);
+            }
+        }
+    }
+}
+
+void SpatialGrid::update(const EntityStore *store)
+{
+    int count = store->get_count();
+    if (count < (int) m_ranges.size()) clear();
+    
+    m_refiled_count = 0;
+    
+    for (int slot = 0; slot < count; slot++)
+    {
+        Bounds bounds = get_bounds(store, slot);
+        CellRange range = get_range(bounds.left, bounds.bottom, bounds.right, bounds.top);
+    
+        if (slot == (int) m_ranges.size())
+        {
+            m_ranges.push_back(range);
+            insert(slot, range);
+            m_refiled_count++;
+            continue;
+        }
+    
+        if (range == m_ranges[slot]) continue;
+    
+        remove(slot, m_ranges[slot]);
+        insert(slot, range);
+        m_ranges[slot] = range;
+        m_refiled_count++;
+    }
+}
+
+void SpatialGrid::find_pairs(std::vector<CollisionPair> &pairs) const
+{
+    pairs.clear();
+    
+    for (size_t cell = 0; cell < m_cells.size(); cell++)
+    {
+        int cell_x = m_cells[cell].x,
+            cell_y = m_cells[cell].y;
+        const std::vector<int> &slots = m_cells[cell].slots;  // Empty if it's on the free list
+    
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            const CellRange &first = m_ranges[slots[i]];
+    
+            for (size_t j = i + 1; j < slots.size(); j++)
+            {
+                const CellRange &second = m_ranges[slots[j]];
+    
+                // Two big boxes can share several cells; only the bottom-left one of those reports them
+                if (std::max(first.min_x, second.min_x) != cell_x || std::max(first.min_y, second.min_y) != cell_y) continue;
+    
+                CollisionPair pair = { std::min(slots[i], slots[j]), std::max(slots[i], slots[j]) };
+                pairs.push_back(pair);
+            }
+        }
+    }
+}
+
+void SpatialGrid::query(float left, float bottom, float right, float top, std::vector<int> &slots) const
+{
+    slots.clear();
+    CellRange range = get_range(left, bottom, right, top);
+    
+    for (int y = range.min_y; y <= range.max_y; y++)
+    {
+        for (int x = range.min_x; x <= range.max_x; x++)
+        {
+            std::unordered_map<uint64_t, int>::const_iterator found = m_cell_lookup.find(get_key(x, y));
+            if (found == m_cell_lookup.end()) continue;
+    
+            const std::vector<int> &cell_slots = m_cells[found->second].slots;
+            for (size_t i = 0; i < cell_slots.size(); i++)
+            {
+                int slot = cell_slots[i];
+                const CellRange &filed = m_ranges[slot];
+    
+                // Same trick as find_pairs, so a slot covering several of these cells only comes up once
+                if (std::max(filed.min_x, range.min_x) == x && std::max(filed.min_y, range.min_y) == y) slots.push_back(slot);
+            }
+        }
+    }
+}
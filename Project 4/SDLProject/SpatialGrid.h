@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+#include <vector>
+#include <unordered_map>
+#include "EntityStore.h"
+#include "Broadphase.h"
+
+// A broadphase that drops every slot of an EntityStore into the square cells its box touches.
+// Only slots sharing a cell can overlap, so finding pairs costs about one check per neighbour
+// instead of one per entity in the level.
+//
+// The cells are hashed rather than laid out in one big array, so the world can be any size.
+// update() is incremental: a slot whose box still touches the same cells as last step (most
+// of them, at our speeds) isn't touched at all
+class SpatialGrid {
+private:
+    // Which cells a slot's box covered when we last filed it, inclusive
+    struct CellRange
+    {
+        int min_x, min_y, max_x, max_y;
+    
+        bool operator==(const CellRange &other) const
+        {
+            return min_x == other.min_x && min_y == other.min_y && max_x == other.max_x && max_y == other.max_y;
+        }
+        bool operator!=(const CellRange &other) const { return !(*this == other); }
+    };
+    
+    struct Cell
+    {
+        int x, y;
+        std::vector<int> slots;
+    };
+    
+    float m_cell_size = 2.0f;
+    
+    // The cells sit side by side so find_pairs can walk straight through them; the map only
+    // says where each one is. Emptied cells go on the free list to be reused by the next new one
+    std::vector<Cell> m_cells;
+    std::vector<int>  m_free_cells;
+    std::unordered_map<uint64_t, int> m_cell_lookup;
+    
+    std::vector<CellRange> m_ranges;  // One per slot
+    
+    int m_refiled_count = 0;
+    
+    CellRange get_range(float left, float bottom, float right, float top) const;
+    
+    // Both halves go through uint32_t first, since shifting a negative signed value is undefined
+    static uint64_t get_key(int x, int y) { return ((uint64_t) (uint32_t) x << 32) | (uint32_t) y; }
+    
+    void insert(int slot, const CellRange &range);
+    void remove(int slot, const CellRange &range);
+
+public:
+    // Cells are best a bit bigger than the entities, so most of them only ever touch one to four
+    void initialise(float cell_size);
+    void clear();
+    
+    // Brings the cells up to date with where the store's slots are now. New slots are added;
+    // if the store has been cleared, so are we
+    void update(const EntityStore *store);
+    
+    // Every pair of slots that share a cell, once each
+    void find_pairs(std::vector<CollisionPair> &pairs) const;
+    
+    // Every slot sharing a cell with the given box, once each
+    void query(float left, float bottom, float right, float top, std::vector<int> &slots) const;
+    
+    // Getters
+    int const get_refiled_count() const { return m_refiled_count; }  // Slots that changed cells in the last update
+    int const get_cell_count()    const { return (int) m_cell_lookup.size(); }
+};
@@ -0,0 +1,103 @@
+#include "SpriteBatch.h"
+
+void SpriteBatch::begin(ShaderProgram *program, StreamBuffer *stream_buffer)
+{
+    // Anything still queued belongs to the previous frame
+    flush();
+
+    m_program       = program;
+    m_stream_buffer = stream_buffer;
+    m_draw_calls   = 0;
+    m_sprite_count = 0;
+}
+
+void SpriteBatch::draw(GLuint texture_id, const glm::mat4 &model_matrix, float u_coord, float v_coord, float width, float height)
+{
+    // A change of texture, or running out of indices, means everything queued so far has to go out first
+    if (texture_id != m_texture_id || m_vertices.size() >= QuadIndexBuffer::MAX_QUADS * VERTICES_PER_QUAD) flush();
+    m_texture_id = texture_id;
+
+    // Since every sprite shares one draw call, we can't use the model matrix uniform anymore
+    // Instead, we move the corners of the unit quad into world space here on the CPU
+    glm::vec4 bottom_left  = model_matrix * glm::vec4(-0.5f, -0.5f, 0.0f, 1.0f);
+    glm::vec4 bottom_right = model_matrix * glm::vec4( 0.5f, -0.5f, 0.0f, 1.0f);
+    glm::vec4 top_right    = model_matrix * glm::vec4( 0.5f,  0.5f, 0.0f, 1.0f);
+    glm::vec4 top_left     = model_matrix * glm::vec4(-0.5f,  0.5f, 0.0f, 1.0f);
+
+    GLushort left   = pack_texture_coordinate(u_coord),
+             right  = pack_texture_coordinate(u_coord + width),
+             top    = pack_texture_coordinate(v_coord),
+             bottom = pack_texture_coordinate(v_coord + height);
+
+    m_vertices.insert(m_vertices.end(), {
+        { top_left.x,     top_left.y,     left,  top    },
+        { bottom_left.x,  bottom_left.y,  left,  bottom },
+        { bottom_right.x, bottom_right.y, right, bottom },
+        { top_right.x,    top_right.y,    right, top    }
+    });
+
+    m_sprite_count++;
+}
+
+void SpriteBatch::draw_quad(GLuint texture_id, float left, float top, float right, float bottom, float u_coord, float v_coord, float width, float height)
+{
+    if (texture_id != m_texture_id || m_vertices.size() >= QuadIndexBuffer::MAX_QUADS * VERTICES_PER_QUAD) flush();
+    m_texture_id = texture_id;
+
+    // Same as above, but for quads that are already axis-aligned in world space (e.g. text)
+    GLushort u_left   = pack_texture_coordinate(u_coord),
+             u_right  = pack_texture_coordinate(u_coord + width),
+             v_top    = pack_texture_coordinate(v_coord),
+             v_bottom = pack_texture_coordinate(v_coord + height);
+
+    m_vertices.insert(m_vertices.end(), {
+        { left,  top,    u_left,  v_top    },
+        { left,  bottom, u_left,  v_bottom },
+        { right, bottom, u_right, v_bottom },
+        { right, top,    u_right, v_top    }
+    });
+
+    m_sprite_count++;
+}
+
+void SpriteBatch::flush()
+{
+    if (m_vertices.empty() || m_program == NULL) return;
+
+    // The vertices are already in world space
+    m_program->SetModelMatrix(glm::mat4(1.0f));
+    RenderState::use_program(m_program);
+
+    GLsizei stride = sizeof(SpriteVertex);
+
+    // With a stream buffer the attribute "pointers" are offsets into it, otherwise they point at our vector
+    GLintptr vertices = m_stream_buffer != NULL ?
+        m_stream_buffer->write(m_vertices.data(), m_vertices.size() * sizeof(SpriteVertex)) :
+        (GLintptr) m_vertices.data();
+
+    if (vertices == StreamBuffer::WRITE_FAILED)
+    {
+        m_vertices.clear();
+        return;
+    }
+
+    glVertexAttribPointer(m_program->positionAttribute, 2, GL_FLOAT, false, stride, (void *) (vertices + offsetof(SpriteVertex, x)));
+    glVertexAttribPointer(m_program->texCoordAttribute, 2, GL_UNSIGNED_SHORT, true, stride, (void *) (vertices + offsetof(SpriteVertex, u)));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    RenderState::enable_attributes(RenderState::attribute_bit(m_program->positionAttribute) |
+                                   RenderState::attribute_bit(m_program->texCoordAttribute));
+
+    RenderState::bind_texture(m_texture_id);
+
+    QuadIndexBuffer::bind();
+    glDrawElements(GL_TRIANGLES, (int) (m_vertices.size() / VERTICES_PER_QUAD) * INDICES_PER_QUAD, GL_UNSIGNED_SHORT, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    m_vertices.clear();
+    m_draw_calls++;
+}
+
+void SpriteBatch::end()
+{
+    flush();
+}
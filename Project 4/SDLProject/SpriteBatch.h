@@ -0,0 +1,43 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <stddef.h>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "Quad.h"
+#include "RenderState.h"
+#include "StreamBuffer.h"
+
+class SpriteBatch {
+private:
+    ShaderProgram *m_program      = NULL;
+    StreamBuffer  *m_stream_buffer = NULL;  // Without one, the vertices go to GL as client memory
+    GLuint m_texture_id      = 0;
+
+    // One interleaved stream for the whole frame, four corners per sprite (see Quad.h)
+    // The vector is cleared (not freed) on every flush, so after the first frame we stop allocating
+    std::vector<SpriteVertex> m_vertices;
+
+    // Stats for the current frame
+    int m_draw_calls   = 0;
+    int m_sprite_count = 0;
+
+public:
+    // Methods
+    void begin(ShaderProgram *program, StreamBuffer *stream_buffer = NULL);
+    void draw(GLuint texture_id, const glm::mat4 &model_matrix, float u_coord, float v_coord, float width, float height);
+    void draw_quad(GLuint texture_id, float left, float top, float right, float bottom, float u_coord, float v_coord, float width, float height);
+    void flush();
+    void end();
+
+    // Getters
+    ShaderProgram * const get_program() const { return m_program; }
+    int const get_draw_calls()   const { return m_draw_calls;   }
+    int const get_sprite_count() const { return m_sprite_count; }
+};
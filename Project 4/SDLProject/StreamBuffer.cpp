@@ -0,0 +1,174 @@
+#include "StreamBuffer.h"
+#include <cassert>
+#include <cstring>
+#include <stdint.h>
+#include <iostream>
+
+#define LOG(argument) std::cout << argument << '\n'
+
+// None of these are in the legacy macOS headers, so we define what we need and look the
+// functions up at runtime (they're only called when the extensions are there)
+#ifndef GL_MAP_WRITE_BIT
+#define GL_MAP_WRITE_BIT 0x0002
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_SYNC_GPU_COMMANDS_COMPLETE
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#endif
+#ifndef GL_SYNC_FLUSH_COMMANDS_BIT
+#define GL_SYNC_FLUSH_COMMANDS_BIT 0x00000001
+#endif
+#ifndef GL_TIMEOUT_EXPIRED
+#define GL_TIMEOUT_EXPIRED 0x911B
+#endif
+
+typedef void      (*BufferStorageFunction)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void     *(*MapBufferRangeFunction)(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef void     *(*FenceSyncFunction)(GLenum condition, GLbitfield flags);
+typedef GLenum    (*ClientWaitSyncFunction)(void *sync, GLbitfield flags, uint64_t timeout);
+typedef void      (*DeleteSyncFunction)(void *sync);
+
+static BufferStorageFunction  buffer_storage   = NULL;
+static MapBufferRangeFunction map_buffer_range = NULL;
+static FenceSyncFunction      fence_sync       = NULL;
+static ClientWaitSyncFunction client_wait_sync = NULL;
+static DeleteSyncFunction     delete_sync      = NULL;
+
+// One millisecond, in the nanoseconds glClientWaitSync counts in
+const uint64_t FENCE_TIMEOUT = 1000000;
+
+void StreamBuffer::initialise(GLsizeiptr region_size)
+{
+    m_region_size = (region_size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    m_region      = 0;
+    m_offset      = 0;
+    
+    if (SDL_GL_ExtensionSupported("GL_ARB_buffer_storage") && SDL_GL_ExtensionSupported("GL_ARB_sync"))
+    {
+        buffer_storage   = (BufferStorageFunction)  SDL_GL_GetProcAddress("glBufferStorage");
+        map_buffer_range = (MapBufferRangeFunction) SDL_GL_GetProcAddress("glMapBufferRange");
+        fence_sync       = (FenceSyncFunction)      SDL_GL_GetProcAddress("glFenceSync");
+        client_wait_sync = (ClientWaitSyncFunction) SDL_GL_GetProcAddress("glClientWaitSync");
+        delete_sync      = (DeleteSyncFunction)     SDL_GL_GetProcAddress("glDeleteSync");
+        
+        m_is_persistent = buffer_storage && map_buffer_range && fence_sync && client_wait_sync && delete_sync;
+    }
+    
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    
+    if (m_is_persistent)
+    {
+        // Coherent, so whatever we memcpy in is visible to the GPU without flushing ranges
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        buffer_storage(GL_ARRAY_BUFFER, m_region_size * REGION_COUNT, NULL, flags);
+        m_mapped = (unsigned char *) map_buffer_range(GL_ARRAY_BUFFER, 0, m_region_size * REGION_COUNT, flags);
+        
+        if (m_mapped == NULL)
+        {
+            LOG("Unable to map the stream buffer.");
+            assert(false);
+        }
+    }
+    else
+    {
+        glBufferData(GL_ARRAY_BUFFER, m_region_size * REGION_COUNT, NULL, GL_STREAM_DRAW);
+    }
+    
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+GLintptr StreamBuffer::write(const void *data, GLsizeiptr size)
+{
+    // Callers handle this themselves (by dropping or splitting the batch), so it isn't fatal
+    if (size > m_region_size)
+    {
+        LOG("Stream buffer write of " << size << " bytes doesn't fit in a " << m_region_size << " byte region.");
+        return WRITE_FAILED;
+    }
+    
+    // Out of room in this region, so this frame carries on in the next one
+    if (m_offset + size > m_region_size) next_region();
+    
+    GLintptr offset = m_region * m_region_size + m_offset;
+    
+    glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+    
+    if (m_is_persistent) memcpy(m_mapped + offset, data, size);
+    else                 glBufferSubData(GL_ARRAY_BUFFER, offset, size, data);
+    
+    m_offset += (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    
+    return offset;
+}
+
+void StreamBuffer::end_frame()
+{
+    // Nothing was written this frame, so there's no reason to give up the region
+    if (m_offset == 0) return;
+    
+    next_region();
+}
+
+void StreamBuffer::next_region()
+{
+    // Everything drawn so far may still be reading from the region we're leaving
+    if (m_is_persistent) m_fences[m_region] = fence_sync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    
+    m_region = (m_region + 1) % REGION_COUNT;
+    m_offset = 0;
+    
+    if (m_is_persistent)
+    {
+        wait_for_region(m_region);
+    }
+    else if (m_region == 0)
+    {
+        // Orphaning: the driver hands us fresh storage and frees the old one once the GPU is done with it
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glBufferData(GL_ARRAY_BUFFER, m_region_size * REGION_COUNT, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void StreamBuffer::wait_for_region(int region)
+{
+    if (m_fences[region] == NULL) return;
+    
+    // With three regions this almost never waits; if it does, the GPU is more than two frames behind
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while (true)
+    {
+        GLenum result = client_wait_sync(m_fences[region], flags, FENCE_TIMEOUT);
+        if (result != GL_TIMEOUT_EXPIRED) break;
+        flags = 0;
+    }
+    
+    delete_sync(m_fences[region]);
+    m_fences[region] = NULL;
+}
+
+void StreamBuffer::cleanup()
+{
+    for (int i = 0; i < REGION_COUNT; i++)
+    {
+        if (m_fences[i] != NULL) delete_sync(m_fences[i]);
+        m_fences[i] = NULL;
+    }
+    
+    if (m_mapped != NULL)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, m_buffer);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        m_mapped = NULL;
+    }
+    
+    glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+}
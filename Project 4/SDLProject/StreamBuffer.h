@@ -0,0 +1,61 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// A vertex buffer for data we rebuild every frame (sprite quads, sprite instances...).
+// It is split into REGION_COUNT regions and each frame writes into the next one, so the GPU
+// can still be reading the last frames' vertices while we write this frame's.
+//
+// Where GL_ARB_buffer_storage and GL_ARB_sync are available (GL 4.4), the buffer is mapped
+// once and stays mapped, and write() is a plain memcpy. A fence at the end of each region
+// makes us wait, if we ever have to, rather than overwrite vertices the GPU hasn't drawn yet.
+// Anywhere else (e.g. the macOS legacy context) we fall back to glBufferSubData, and orphan
+// the whole buffer with glBufferData whenever we wrap around to the first region.
+class StreamBuffer {
+private:
+    static const int REGION_COUNT = 3;
+    
+    // Where a write starts has to line up for every attribute type we use
+    static const int ALIGNMENT = 16;
+    
+    GLuint     m_buffer      = 0;
+    GLsizeiptr m_region_size = 0;
+    int        m_region      = 0;
+    GLintptr   m_offset      = 0;  // From the start of the current region
+    
+    bool           m_is_persistent = false;
+    unsigned char *m_mapped        = NULL;
+    
+    // GLsync is a pointer, but the legacy macOS headers don't know the type, so we keep our own
+    void *m_fences[REGION_COUNT] = { NULL };
+    
+    void next_region();
+    void wait_for_region(int region);
+    
+public:
+    // What write() returns when it couldn't take the data
+    static const GLintptr WRITE_FAILED = -1;
+    
+    // Methods
+    void initialise(GLsizeiptr region_size);
+    
+    // Copies size bytes into the buffer and returns their offset, which is what
+    // glVertexAttribPointer wants while the buffer is bound. Leaves the buffer bound.
+    // Anything bigger than a region is refused with WRITE_FAILED and nothing is copied, so
+    // callers have to split their data into region-sized writes
+    GLintptr write(const void *data, GLsizeiptr size);
+    
+    // Marks the end of everything that reads this frame's region
+    void end_frame();
+    void cleanup();
+    
+    // Getters
+    GLuint     const get_buffer()      const { return m_buffer;        }
+    bool       const is_persistent()   const { return m_is_persistent; }
+    GLsizeiptr const get_region_size() const { return m_region_size;   }
+};
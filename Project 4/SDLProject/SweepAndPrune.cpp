@@ -0,0 +1,100 @@
+#include <algorithm>
+#include "SweepAndPrune.h"
+
+void SweepAndPrune::clear()
+{
+    m_endpoints.clear();
+    m_bounds.clear();
+    m_open_slots.clear();
+    m_open_positions.clear();
+    m_swap_count = 0;
+}
+
+void SweepAndPrune::update(const EntityStore *store)
+{
+    int count = store->get_count();
+    if (count < (int) m_bounds.size()) clear();
+    
+    m_swap_count = 0;
+    
+    bool slots_added = count > (int) m_bounds.size();
+    for (int slot = (int) m_bounds.size(); slot < count; slot++)
+    {
+        Endpoint left  = { 0.0f, slot * 2     },
+                 right = { 0.0f, slot * 2 + 1 };
+        m_endpoints.push_back(left);
+        m_endpoints.push_back(right);
+    }
+    
+    m_bounds.resize(count);
+    m_open_positions.resize(count);
+    
+    for (int slot = 0; slot < count; slot++) m_bounds[slot] = get_bounds(store, slot);
+    
+    for (size_t i = 0; i < m_endpoints.size(); i++)
+    {
+        const Bounds &bounds = m_bounds[m_endpoints[i].get_slot()];
+        m_endpoints[i].value = m_endpoints[i].is_left_edge() ? bounds.left : bounds.right;
+    }
+    
+    // New slots start at the end of the list, nowhere near where they belong, and the insertion
+    // sort below would walk every one of them there an edge at a time. Spawning is rare enough
+    // that sorting from scratch on those steps is cheaper
+    if (slots_added)
+    {
+        std::sort(m_endpoints.begin(), m_endpoints.end());
+        return;
+    }
+    
+    for (size_t i = 1; i < m_endpoints.size(); i++)
+    {
+        Endpoint endpoint = m_endpoints[i];
+        size_t j = i;
+    
+        while (j > 0 && endpoint < m_endpoints[j - 1])
+        {
+            m_endpoints[j] = m_endpoints[j - 1];
+            j--;
+        }
+    
+        m_endpoints[j] = endpoint;
+        m_swap_count += (int) (i - j);
+    }
+}
+
+void SweepAndPrune::find_pairs(std::vector<CollisionPair> &pairs) const
+{
+    pairs.clear();
+    m_open_slots.clear();
+    
+    for (size_t i = 0; i < m_endpoints.size(); i++)
+    {
+        int slot = m_endpoints[i].get_slot();
+    
+        if (!m_endpoints[i].is_left_edge())
+        {
+            // Swap the last open box into this one's place
+            int position = m_open_positions[slot],
+                last     = m_open_slots.back();
+    
+            m_open_slots[position]   = last;
+            m_open_positions[last]   = position;
+            m_open_slots.pop_back();
+            continue;
+        }
+    
+        // Everything still open overlaps this box along x, so only y is left to check
+        const Bounds &bounds = m_bounds[slot];
+        for (size_t j = 0; j < m_open_slots.size(); j++)
+        {
+            int other = m_open_slots[j];
+            if (m_bounds[other].bottom > bounds.top || bounds.bottom > m_bounds[other].top) continue;
+    
+            CollisionPair pair = { std::min(slot, other), std::max(slot, other) };
+            pairs.push_back(pair);
+        }
+    
+        m_open_positions[slot] = (int) m_open_slots.size();
+        m_open_slots.push_back(slot);
+    }
+}
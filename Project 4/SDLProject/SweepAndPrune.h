@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include "EntityStore.h"
+#include "Broadphase.h"
+
+// A broadphase that keeps the left and right edges of every EntityStore slot's box in one list
+// sorted along x. Sweeping that list from left to right, the boxes we've passed the left edge
+// but not the right edge of are exactly the ones overlapping in x, so each new box only has to
+// check those for y.
+//
+// That suits our levels: they are long strips only a few tiles tall, so few boxes ever share
+// an x. Between fixed steps everything moves a fraction of a tile and the list is still almost
+// in order, so update() re-sorts it with an insertion sort that only pays for the edges that
+// actually passed one another
+class SweepAndPrune {
+private:
+    // One edge of a slot's box along x. The slot and which edge it is share an int, to keep the
+    // list we sort every step as small as we can
+    struct Endpoint
+    {
+        float value;
+        int   slot_and_edge;  // slot * 2, plus one for a right edge
+    
+        int  const get_slot()     const { return slot_and_edge >> 1; }
+        bool const is_left_edge() const { return (slot_and_edge & 1) == 0; }
+    
+        // Left edges go first on a tie, so boxes that only touch still come up; check_collision
+        // throws those out afterwards
+        bool operator<(const Endpoint &other) const
+        {
+            if (value != other.value) return value < other.value;
+            return is_left_edge() && !other.is_left_edge();
+        }
+    };
+    
+    std::vector<Endpoint> m_endpoints;  // Two per slot
+    std::vector<Bounds>   m_bounds;     // One per slot, from the last update
+    
+    // The boxes find_pairs has passed the left but not the right edge of, and where each of them
+    // is in that list so taking one out doesn't mean searching for it
+    mutable std::vector<int> m_open_slots;
+    mutable std::vector<int> m_open_positions;
+    
+    int m_swap_count = 0;
+    
+public:
+    void clear();
+    
+    // Brings the edges up to date with where the store's slots are now. New slots are added;
+    // if the store has been cleared, so are we
+    void update(const EntityStore *store);
+    
+    // Every pair of slots whose boxes overlap or touch, once each
+    void find_pairs(std::vector<CollisionPair> &pairs) const;
+    
+    // Getters
+    int const get_swap_count() const { return m_swap_count; }  // Edges moved past one another in the last update
+};
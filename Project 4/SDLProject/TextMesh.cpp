@@ -0,0 +1,139 @@
+#include "TextMesh.h"
+#include "glm/gtc/matrix_transform.hpp"
+
+TextMesh::TextMesh(GLuint font_texture_id, AtlasRegion font_region, float screen_size, float spacing, glm::vec3 position)
+{
+    m_font_texture_id = font_texture_id;
+    m_font_region     = font_region;
+    m_screen_size     = screen_size;
+    m_spacing         = spacing;
+    
+    set_position(position);
+}
+
+TextMesh::~TextMesh()
+{
+    glDeleteBuffers(1, &m_vertex_buffer);
+}
+
+void TextMesh::set_position(glm::vec3 position)
+{
+    // The glyphs are built around the origin, so moving the text never touches them
+    m_model_matrix = glm::translate(glm::mat4(1.0f), position);
+}
+
+void TextMesh::set_text(const std::string &text)
+{
+    // Same string as last frame: nothing to do, and nothing allocated
+    if (text == m_text) return;
+    
+    int old_length = (int) m_text.size(),
+        new_length = (int) text.size();
+    
+    // Skip the characters that match at the start, and (if the length is unchanged) at the end
+    int first = 0;
+    while (first < old_length && first < new_length && m_text[first] == text[first]) first++;
+    
+    int last = new_length;
+    if (old_length == new_length)
+    {
+        while (last > first && m_text[last - 1] == text[last - 1]) last--;
+    }
+    
+    // assign() reuses the string's storage, and resize() the vector's, as long as the text doesn't grow
+    m_text.assign(text);
+    m_vertices.resize(new_length * VERTICES_PER_QUAD);
+    
+    for (int i = first; i < last; i++) build_glyph(i);
+    
+    // Grow the dirty span to cover this edit too, in case we haven't uploaded since the last one
+    if (m_dirty_first == m_dirty_last)
+    {
+        m_dirty_first = first;
+        m_dirty_last  = last;
+    }
+    else
+    {
+        m_dirty_first = m_dirty_first < first ? m_dirty_first : first;
+        m_dirty_last  = m_dirty_last  > last  ? m_dirty_last  : last;
+    }
+    if (m_dirty_last > new_length) m_dirty_last = new_length;
+}
+
+void TextMesh::build_glyph(int index)
+{
+    // Scale the size of the fontbank in the UV-plane (and to the font's place in the atlas)
+    float width  = m_font_region.width  / FONTBANK_SIZE;
+    float height = m_font_region.height / FONTBANK_SIZE;
+    
+    int   spritesheet_index = (int) (unsigned char) m_text[index];  // ascii value of character
+    float offset            = (m_screen_size + m_spacing) * index;
+    
+    float u_coordinate = m_font_region.u + (spritesheet_index % FONTBANK_SIZE) * width;
+    float v_coordinate = m_font_region.v + (spritesheet_index / FONTBANK_SIZE) * height;
+    
+    float left   = offset - 0.5f * m_screen_size,
+          right  = offset + 0.5f * m_screen_size,
+          top    =  0.5f * m_screen_size,
+          bottom = -0.5f * m_screen_size;
+    
+    GLushort u_left   = pack_texture_coordinate(u_coordinate),
+             u_right  = pack_texture_coordinate(u_coordinate + width),
+             v_top    = pack_texture_coordinate(v_coordinate),
+             v_bottom = pack_texture_coordinate(v_coordinate + height);
+    
+    SpriteVertex *corners = &m_vertices[index * VERTICES_PER_QUAD];
+    corners[0] = { left,  top,    u_left,  v_top    };
+    corners[1] = { left,  bottom, u_left,  v_bottom };
+    corners[2] = { right, bottom, u_right, v_bottom };
+    corners[3] = { right, top,    u_right, v_top    };
+}
+
+void TextMesh::upload()
+{
+    if (m_vertex_buffer == 0) glGenBuffers(1, &m_vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    
+    int character_count = (int) m_text.size();
+    
+    if (character_count > m_buffer_capacity)
+    {
+        // The text outgrew the buffer, so everything goes up again into a bigger one
+        glBufferData(GL_ARRAY_BUFFER, m_vertices.size() * sizeof(SpriteVertex), m_vertices.data(), GL_DYNAMIC_DRAW);
+        m_buffer_capacity = character_count;
+    }
+    else
+    {
+        // Otherwise only the changed characters are sent
+        GLintptr offset = m_dirty_first * VERTICES_PER_QUAD * sizeof(SpriteVertex);
+        GLsizei  size   = (m_dirty_last - m_dirty_first) * VERTICES_PER_QUAD * sizeof(SpriteVertex);
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, &m_vertices[m_dirty_first * VERTICES_PER_QUAD]);
+    }
+    
+    m_dirty_first = m_dirty_last = 0;
+}
+
+void TextMesh::render(ShaderProgram *program)
+{
+    if (m_text.empty()) return;
+    
+    if (m_dirty_first != m_dirty_last || m_vertex_buffer == 0) upload();
+    else glBindBuffer(GL_ARRAY_BUFFER, m_vertex_buffer);
+    
+    program->SetModelMatrix(m_model_matrix);
+    RenderState::use_program(program);
+    
+    GLsizei stride = sizeof(SpriteVertex);
+    
+    glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, stride, (void *) offsetof(SpriteVertex, x));
+    glVertexAttribPointer(program->texCoordAttribute, 2, GL_UNSIGNED_SHORT, true, stride, (void *) offsetof(SpriteVertex, u));
+    RenderState::enable_attributes(RenderState::attribute_bit(program->positionAttribute) |
+                                   RenderState::attribute_bit(program->texCoordAttribute));
+    
+    RenderState::bind_texture(m_font_texture_id);
+    
+    QuadIndexBuffer::bind();
+    glDrawElements(GL_TRIANGLES, (int) m_text.size() * INDICES_PER_QUAD, GL_UNSIGNED_SHORT, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
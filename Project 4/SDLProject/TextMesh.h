@@ -0,0 +1,59 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "Quad.h"
+#include "TextureAtlas.h"
+#include "RenderState.h"
+
+// A string of text that keeps its glyph quads around between frames, both on the CPU and in a
+// GL buffer. Changing the text only rebuilds (and re-uploads) the characters that actually changed
+class TextMesh {
+private:
+    GLuint      m_font_texture_id;
+    AtlasRegion m_font_region;
+    float       m_screen_size;
+    float       m_spacing;
+    glm::mat4   m_model_matrix;
+    
+    std::string m_text;
+    
+    // Four corners per character (see Quad.h), relative to the position of the first character
+    std::vector<SpriteVertex> m_vertices;
+    
+    GLuint m_vertex_buffer   = 0;
+    int    m_buffer_capacity = 0; // In characters
+    
+    // The characters whose quads changed since the last upload, as [first, last)
+    int m_dirty_first = 0;
+    int m_dirty_last  = 0;
+    
+    void build_glyph(int index);
+    void upload();
+    
+public:
+    // How many characters wide and tall the font's spritesheet is
+    static const int FONTBANK_SIZE = 16;
+    
+    // Constructor
+    TextMesh(GLuint font_texture_id, AtlasRegion font_region, float screen_size, float spacing, glm::vec3 position);
+    ~TextMesh();
+    
+    // Methods
+    void set_text(const std::string &text);
+    void set_position(glm::vec3 position);
+    void render(ShaderProgram *program);
+    
+    // Getters
+    std::string const &get_text()       const { return m_text;            }
+    GLuint      const  get_texture_id() const { return m_font_texture_id; }
+};
@@ -0,0 +1,150 @@
+#include "TextureAtlas.h"
+#include "CookedTexture.h"
+#include "RenderState.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include "stb_image.h"
+
+#define LOG(argument) std::cout << argument << '\n'
+
+void TextureAtlas::add(const char *filepath)
+{
+    AtlasImage image;
+    image.filepath = filepath;
+    image.x        = 0;
+    image.y        = 0;
+    
+    // The atlas has no use for the cooked mip chain, but the top level saves us decoding the PNG
+    CookedTexture cooked;
+    if (cooked.open(filepath))
+    {
+        CookedTexture::Level level = cooked.get_level(0);
+        image.width  = level.width;
+        image.height = level.height;
+        image.pixels.assign(cooked.get_pixels(0), cooked.get_pixels(0) + level.size);
+        
+        m_images.push_back(image);
+        return;
+    }
+    
+    unsigned char *pixels = stbi_load(filepath, &image.width, &image.height, NULL, STBI_rgb_alpha);
+    
+    if (pixels == NULL)
+    {
+        LOG("Unable to load image. Make sure the path is correct.");
+        assert(false);
+    }
+    
+    image.pixels.assign(pixels, pixels + image.width * image.height * 4);
+    stbi_image_free(pixels);
+    
+    m_images.push_back(image);
+}
+
+bool TextureAtlas::pack(int width, int height)
+{
+    // Shelf packing: fill rows left to right, and when an image doesn't fit start a new row
+    // under the tallest image of the current one. Sorting tallest-first keeps the rows tight.
+    std::vector<AtlasImage*> order;
+    for (int i = 0; i < m_images.size(); i++) order.push_back(&m_images[i]);
+    
+    std::sort(order.begin(), order.end(), [](AtlasImage *a, AtlasImage *b) { return a->height > b->height; });
+    
+    int shelf_x = 0,
+        shelf_y = 0,
+        shelf_height = 0;
+    
+    for (int i = 0; i < order.size(); i++)
+    {
+        AtlasImage *image = order[i];
+        int padded_width  = image->width  + PADDING * 2;
+        int padded_height = image->height + PADDING * 2;
+        
+        if (shelf_x + padded_width > width)
+        {
+            shelf_x = 0;
+            shelf_y += shelf_height;
+            shelf_height = 0;
+        }
+        
+        if (padded_width > width || shelf_y + padded_height > height) return false;
+        
+        image->x = shelf_x + PADDING;
+        image->y = shelf_y + PADDING;
+        
+        shelf_x += padded_width;
+        shelf_height = std::max(shelf_height, padded_height);
+    }
+    
+    return true;
+}
+
+GLuint TextureAtlas::build()
+{
+    GLint max_size;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+    
+    // Grow a power-of-two texture, alternating width and height, until everything fits
+    m_width  = 256;
+    m_height = 256;
+    while (!pack(m_width, m_height))
+    {
+        if (m_width <= m_height) m_width  *= 2;
+        else                     m_height *= 2;
+        
+        if (m_width > max_size || m_height > max_size)
+        {
+            LOG("Unable to fit the images into a single texture.");
+            assert(false);
+        }
+    }
+    
+    // Copy every image into place, one row at a time
+    std::vector<unsigned char> pixels(m_width * m_height * 4, 0);
+    for (int i = 0; i < m_images.size(); i++)
+    {
+        AtlasImage &image = m_images[i];
+        for (int row = 0; row < image.height; row++)
+        {
+            memcpy(&pixels[((image.y + row) * m_width + image.x) * 4],
+                   &image.pixels[row * image.width * 4],
+                   image.width * 4);
+        }
+        
+        // Only the packed copy is needed from here on
+        std::vector<unsigned char>().swap(image.pixels);
+    }
+    
+    glGenTextures(1, &m_texture_id);
+    RenderState::bind_texture(m_texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    
+    return m_texture_id;
+}
+
+AtlasRegion const TextureAtlas::get_region(const char *filepath) const
+{
+    AtlasRegion region;
+    
+    for (int i = 0; i < m_images.size(); i++)
+    {
+        if (m_images[i].filepath != filepath) continue;
+        
+        region.u      = (float) m_images[i].x      / m_width;
+        region.v      = (float) m_images[i].y      / m_height;
+        region.width  = (float) m_images[i].width  / m_width;
+        region.height = (float) m_images[i].height / m_height;
+        return region;
+    }
+    
+    LOG("No image called " << filepath << " in the texture atlas.");
+    assert(false);
+    return region;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#define GL_SILENCE_DEPRECATION
+#ifdef _WINDOWS
+#include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <string>
+#include <vector>
+#include <SDL.h>
+#include <SDL_opengl.h>
+
+// Where one of the packed images ended up, in the atlas's UV space
+// The default covers a whole texture, so code that doesn't use an atlas can ignore this
+struct AtlasRegion
+{
+    float u      = 0.0f;
+    float v      = 0.0f;
+    float width  = 1.0f;
+    float height = 1.0f;
+};
+
+class TextureAtlas {
+private:
+    struct AtlasImage
+    {
+        std::string filepath;
+        std::vector<unsigned char> pixels;
+        int width, height;
+        int x, y;
+    };
+    
+    std::vector<AtlasImage> m_images;
+    
+    GLuint m_texture_id = 0;
+    int m_width  = 0;
+    int m_height = 0;
+    
+    bool pack(int width, int height);
+    
+public:
+    // Empty pixels kept around every image so neighbours never bleed into each other
+    static const int PADDING = 2;
+    
+    // Methods
+    void add(const char *filepath);
+    GLuint build();
+    AtlasRegion const get_region(const char *filepath) const;
+    
+    // Getters
+    GLuint const get_texture_id()  const { return m_texture_id;          }
+    int    const get_width()       const { return m_width;               }
+    int    const get_height()      const { return m_height;              }
+    int    const get_image_count() const { return (int) m_images.size(); }
+};
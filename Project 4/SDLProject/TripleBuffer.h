@@ -0,0 +1,42 @@
+#pragma once
+#include <atomic>
+
+// Hands whole values from one thread to another without either of them ever waiting.
+// The writer fills the back slot and publishes it; the reader picks up whatever was published
+// last. With three slots there's always one for each side plus the one in between, so the
+// writer never overwrites what the reader is looking at, and the reader never sees half a value
+//
+// Only one thread may write and only one may read
+template <typename T>
+class TripleBuffer {
+private:
+    static const int INDEX_MASK = 3;
+    static const int FRESH_BIT  = 4;  // Set when the middle slot holds something the reader hasn't taken yet
+    
+    T m_slots[3];
+    
+    int m_back  = 0;                // Writer's
+    int m_front = 1;                // Reader's
+    std::atomic<int> m_middle { 2 };
+    
+public:
+    // Writer: fill this in, then publish it
+    T &get_back() { return m_slots[m_back]; }
+    
+    void publish()
+    {
+        // Release so the reader sees everything we wrote, acquire so we get a slot it's done with
+        m_back = m_middle.exchange(m_back | FRESH_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+    
+    // Reader: returns false (and keeps the old front) if nothing new has been published
+    bool update()
+    {
+        if ((m_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0) return false;
+        
+        m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+    
+    const T &get_front() const { return m_slots[m_front]; }
+};
@@ -0,0 +1,282 @@
+/**
+* AABB tree benchmark
+*
+* Fills a level with colliders, three quarters of them static platforms and the rest enemies
+* running around, and times what AABBTree costs per fixed step: the update, a batch of
+* entity-sized box queries and a batch of short ray casts. The level quadruples a few times up
+* to the count you give, staying equally crowded. Each time the tree only gets about two levels
+* deeper, so query times should go up by a step rather than quadrupling (a bigger step once the
+* tree no longer fits in the cache).
+*
+* A second run keeps the enemies at a fixed count and piles on more and more platforms, to show
+* that once they're in, platforms add next to nothing to the update:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/aabb_tree_benchmark.cpp EntityStore.cpp EntityKernels.cpp AABBTree.cpp -o aabb_tree_benchmark
+*   ./aabb_tree_benchmark [colliders] [steps]
+*
+* Up to BRUTE_FORCE_LIMIT colliders every query and ray cast is also checked against every
+* collider, and the two have to agree.
+**/
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "EntityStore.h"
+#include "EntityKernels.h"
+#include "AABBTree.h"
+
+const int DEFAULT_COLLIDER_COUNT = 256000,
+          DEFAULT_STEP_COUNT     = 60,
+          SCALING_STEPS          = 5,      // Runs at 1/256, 1/64, 1/16, 1/4 and all of the colliders
+          QUERIES_PER_STEP       = 1000,
+          ENEMY_COUNT            = 1000,   // For the piling-on run
+          BRUTE_FORCE_LIMIT      = 16000;
+
+const float FIXED_TIMESTEP       = 1.0f / 60.0f,
+            COLLIDERS_PER_AREA   = 0.25f,
+            STATIC_SHARE         = 0.75f,
+            ENEMY_SIZE           = 0.8f,
+            PLATFORM_WIDTH       = 2.0f,
+            PLATFORM_HEIGHT      = 0.5f,
+            MAXIMUM_SPEED        = 6.0f,
+            RAY_LENGTH           = 8.0f,
+            TREE_MARGIN          = 0.1f;
+
+float random_between(float low, float high)
+{
+    return low + (high - low) * (rand() / (float) RAND_MAX);
+}
+
+// Adds platforms first and enemies after, flagging the platforms as static before the tree
+// ever sees them
+void fill(EntityStore *store, AABBTree *tree, int platform_count, int enemy_count, float world_size)
+{
+    store->reserve(platform_count + enemy_count);
+    
+    for (int i = 0; i < platform_count + enemy_count; i++)
+    {
+        bool is_platform = i < platform_count;
+    
+        int index = store->add();
+        store->position_x[index] = random_between(0.0f, world_size);
+        store->position_y[index] = random_between(0.0f, world_size);
+        store->width[index]      = is_platform ? PLATFORM_WIDTH  : ENEMY_SIZE;
+        store->height[index]     = is_platform ? PLATFORM_HEIGHT : ENEMY_SIZE;
+    
+        if (is_platform)
+        {
+            tree->set_static(index, true);
+            continue;
+        }
+    
+        store->movement_x[index] = 1.0f;
+        store->speed[index]      = random_between(-MAXIMUM_SPEED, MAXIMUM_SPEED);
+        store->velocity_y[index] = random_between(-MAXIMUM_SPEED, MAXIMUM_SPEED);
+    }
+}
+
+// Turn any enemy that has reached a wall around, so everyone stays in the same area
+void bounce(EntityStore *store, float world_size)
+{
+    for (int i = 0; i < store->get_count(); i++)
+    {
+        if ((store->position_x[i] < 0.0f && store->speed[i] < 0.0f) || (store->position_x[i] > world_size && store->speed[i] > 0.0f))
+        {
+            store->speed[i] = -store->speed[i];
+        }
+        if ((store->position_y[i] < 0.0f && store->velocity_y[i] < 0.0f) || (store->position_y[i] > world_size && store->velocity_y[i] > 0.0f))
+        {
+            store->velocity_y[i] = -store->velocity_y[i];
+        }
+    }
+}
+
+bool touches(const Bounds &a, const Bounds &b)
+{
+    return a.left <= b.right && b.left <= a.right && a.bottom <= b.top && b.bottom <= a.top;
+}
+
+// The same slab test the tree does, for checking it against every collider
+bool segment_hits(const Bounds &bounds, float start_x, float start_y, float direction_x, float direction_y, float &fraction)
+{
+    float low = 0.0f, high = 1.0f;
+    float starts[2] = { start_x, start_y }, directions[2] = { direction_x, direction_y },
+          minimums[2] = { bounds.left, bounds.bottom }, maximums[2] = { bounds.right, bounds.top };
+    
+    for (int axis = 0; axis < 2; axis++)
+    {
+        if (directions[axis] == 0.0f)
+        {
+            if (starts[axis] < minimums[axis] || starts[axis] > maximums[axis]) return false;
+            continue;
+        }
+    
+        float near = (minimums[axis] - starts[axis]) / directions[axis],
+              far  = (maximums[axis] - starts[axis]) / directions[axis];
+        if (near > far) std::swap(near, far);
+    
+        low  = std::max(low, near);
+        high = std::min(high, far);
+        if (low > high) return false;
+    }
+    
+    fraction = low;
+    return true;
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Query
+{
+    Bounds box;
+    float  end_x, end_y;
+};
+
+// Returns false if the tree and the every-collider check disagreed anywhere
+bool run(int platform_count, int enemy_count, int step_count, bool time_queries)
+{
+    int   collider_count = platform_count + enemy_count;
+    float world_size     = sqrtf(collider_count / COLLIDERS_PER_AREA);
+    bool  brute_force    = time_queries && collider_count <= BRUTE_FORCE_LIMIT,
+          all_agree      = true;
+    
+    srand(1);
+    EntityStore store;
+    AABBTree tree;
+    tree.initialise(TREE_MARGIN);
+    fill(&store, &tree, platform_count, enemy_count, world_size);
+    
+    // Filing everything the first time isn't what we're measuring
+    tree.update(&store);
+    
+    std::vector<Query> queries(QUERIES_PER_STEP);
+    std::vector<int> found;
+    
+    double update_milliseconds = 0.0,
+           query_milliseconds  = 0.0,
+           ray_milliseconds    = 0.0;
+    long   refiled_count       = 0,
+           found_count         = 0,
+           hit_count           = 0;
+    
+    for (int step = 0; step < step_count; step++)
+    {
+        store.integrate(FIXED_TIMESTEP);
+        bounce(&store, world_size);
+    
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        tree.update(&store);
+        update_milliseconds += milliseconds_since(start);
+        refiled_count += tree.get_refiled_count();
+    
+        if (!time_queries) continue;
+    
+        for (int i = 0; i < QUERIES_PER_STEP; i++)
+        {
+            float x = random_between(0.0f, world_size),
+                  y = random_between(0.0f, world_size),
+                  angle = random_between(0.0f, 6.2831853f);
+    
+            Bounds box = { x - ENEMY_SIZE / 2.0f, y - ENEMY_SIZE / 2.0f, x + ENEMY_SIZE / 2.0f, y + ENEMY_SIZE / 2.0f };
+            queries[i].box   = box;
+            queries[i].end_x = x + RAY_LENGTH * cosf(angle);
+            queries[i].end_y = y + RAY_LENGTH * sinf(angle);
+        }
+    
+        // What the tree finds is only a shortlist; count the ones really touching the box
+        start = std::chrono::steady_clock::now();
+        std::vector<int> exact_counts(QUERIES_PER_STEP);
+        for (int i = 0; i < QUERIES_PER_STEP; i++)
+        {
+            const Bounds &box = queries[i].box;
+            tree.query(box.left, box.bottom, box.right, box.top, found);
+    
+            for (size_t j = 0; j < found.size(); j++) exact_counts[i] += touches(get_bounds(&store, found[j]), box);
+            found_count += exact_counts[i];
+        }
+        query_milliseconds += milliseconds_since(start);
+    
+        start = std::chrono::steady_clock::now();
+        std::vector<float> hit_fractions(QUERIES_PER_STEP);
+        for (int i = 0; i < QUERIES_PER_STEP; i++)
+        {
+            float centre_x = (queries[i].box.left + queries[i].box.right) / 2.0f,
+                  centre_y = (queries[i].box.bottom + queries[i].box.top) / 2.0f;
+    
+            hit_count += tree.ray_cast(centre_x, centre_y, queries[i].end_x, queries[i].end_y, -1, hit_fractions[i]) != -1;
+        }
+        ray_milliseconds += milliseconds_since(start);
+    
+        if (!brute_force) continue;
+    
+        for (int i = 0; i < QUERIES_PER_STEP; i++)
+        {
+            const Bounds &box = queries[i].box;
+            float centre_x = (box.left + box.right) / 2.0f,
+                  centre_y = (box.bottom + box.top) / 2.0f;
+    
+            int   touching      = 0;
+            float closest       = 1.0f,
+                  fraction;
+            for (int slot = 0; slot < collider_count; slot++)
+            {
+                Bounds bounds = get_bounds(&store, slot);
+                touching += touches(bounds, box);
+                if (segment_hits(bounds, centre_x, centre_y, queries[i].end_x - centre_x, queries[i].end_y - centre_y, fraction))
+                {
+                    closest = std::min(closest, fraction);
+                }
+            }
+    
+            if (touching != exact_counts[i] || closest != hit_fractions[i]) all_agree = false;
+        }
+    }
+    
+    std::cout << "  " << platform_count << " platforms, " << enemy_count << " enemies: height " << tree.get_height()
+              << ", update " << update_milliseconds / step_count << " ms (" << refiled_count / step_count << " refiled)";
+    if (time_queries)
+    {
+        long query_count = (long) step_count * QUERIES_PER_STEP;
+        std::cout << ", box query " << query_milliseconds * 1000000.0 / query_count << " ns ("
+                  << (double) found_count / query_count << " found), ray cast " << ray_milliseconds * 1000000.0 / query_count
+                  << " ns (" << 100.0 * hit_count / query_count << "% hit)";
+    }
+    std::cout << '\n';
+    
+    return all_agree;
+}
+
+int main(int argc, char* argv[])
+{
+    int largest_count = argc > 1 ? atoi(argv[1]) : DEFAULT_COLLIDER_COUNT;
+    int step_count    = argc > 2 ? atoi(argv[2]) : DEFAULT_STEP_COUNT;
+    bool all_agree    = true;
+    
+    LOG(step_count << " steps per run, " << QUERIES_PER_STEP << " box queries and ray casts per step");
+    
+    LOG("Growing level:");
+    for (int scale = SCALING_STEPS - 1; scale >= 0; scale--)
+    {
+        int collider_count = largest_count >> (2 * scale);
+        int platform_count = (int) (collider_count * STATIC_SHARE);
+        all_agree = run(platform_count, collider_count - platform_count, step_count, true) && all_agree;
+    }
+    
+    LOG("Piling on platforms:");
+    for (int scale = SCALING_STEPS - 1; scale >= 0; scale--)
+    {
+        int platform_count = largest_count >> (2 * scale);
+        all_agree = run(platform_count, ENEMY_COUNT, step_count, false) && all_agree;
+    }
+    
+    if (!all_agree) LOG("The tree and the every-collider check disagreed!");
+    return all_agree ? 0 : 1;
+}
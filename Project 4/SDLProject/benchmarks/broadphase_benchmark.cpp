@@ -0,0 +1,213 @@
+/**
+* Broadphase benchmark
+*
+* Moves a crowd of entities around a walled-in area and finds every overlapping pair each
+* fixed step: by testing every entity against every other (what looping over
+* Entity::check_collision amounts to), through SpatialGrid, SweepAndPrune and AABBTree. The
+* crowd doubles a few times up to the count you give, with the area growing alongside so it
+* stays equally dense, to show how each one scales. That happens twice: once in a square, and
+* once in a strip LEVEL_HEIGHT tall that only grows wider, the way our levels do:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/broadphase_benchmark.cpp EntityStore.cpp EntityKernels.cpp SpatialGrid.cpp SweepAndPrune.cpp AABBTree.cpp -o broadphase_benchmark
+*   ./broadphase_benchmark [entities] [steps]
+*
+* Testing everything against everything gets slow quickly, so it stops at BRUTE_FORCE_LIMIT.
+* Whichever of them run, they have to agree on the number of overlaps every step.
+**/
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "EntityStore.h"
+#include "EntityKernels.h"
+#include "SpatialGrid.h"
+#include "SweepAndPrune.h"
+#include "AABBTree.h"
+
+const int DEFAULT_ENTITY_COUNT = 50000,
+          DEFAULT_STEP_COUNT   = 120,
+          SCALING_STEPS        = 5,       // Runs at 1/16, 1/8, 1/4, 1/2 and all of the entities
+          BRUTE_FORCE_LIMIT    = 12500;
+
+const float FIXED_TIMESTEP    = 1.0f / 60.0f,
+            ENTITY_SIZE       = 0.8f,
+            ENTITIES_PER_AREA = 0.25f,     // About one entity every four square units
+            MAXIMUM_SPEED     = 3.0f,
+            GRID_CELL_SIZE    = 2.0f,
+            TREE_MARGIN       = 0.1f,
+            LEVEL_HEIGHT      = 5.0f;      // Project 4's LEVEL1_HEIGHT
+
+// The same test Entity::check_collision does, minus the active flags
+bool overlaps(const EntityStore *store, int a, int b)
+{
+    float x_distance = fabs(store->position_x[a] - store->position_x[b]) - ((store->width[a]  + store->width[b])  / 2.0f);
+    float y_distance = fabs(store->position_y[a] - store->position_y[b]) - ((store->height[a] + store->height[b]) / 2.0f);
+    
+    return x_distance < 0.0f && y_distance < 0.0f;
+}
+
+float random_between(float low, float high)
+{
+    return low + (high - low) * (rand() / (float) RAND_MAX);
+}
+
+void fill(EntityStore *store, int entity_count, float world_width, float world_height)
+{
+    srand(1);
+    store->reserve(entity_count);
+    
+    for (int i = 0; i < entity_count; i++)
+    {
+        int index = store->add();
+        store->position_x[index] = random_between(0.0f, world_width);
+        store->position_y[index] = random_between(0.0f, world_height);
+        store->movement_x[index] = 1.0f;
+        store->speed[index]      = random_between(-MAXIMUM_SPEED, MAXIMUM_SPEED);
+        store->velocity_y[index] = random_between(-MAXIMUM_SPEED, MAXIMUM_SPEED);
+        store->width[index]      = ENTITY_SIZE;
+        store->height[index]     = ENTITY_SIZE;
+    }
+}
+
+// Turn anyone who has reached a wall around, so the crowd stays in the same area
+void bounce(EntityStore *store, float world_width, float world_height)
+{
+    for (int i = 0; i < store->get_count(); i++)
+    {
+        if ((store->position_x[i] < 0.0f && store->speed[i] < 0.0f) || (store->position_x[i] > world_width && store->speed[i] > 0.0f))
+        {
+            store->speed[i] = -store->speed[i];
+        }
+        if ((store->position_y[i] < 0.0f && store->velocity_y[i] < 0.0f) || (store->position_y[i] > world_height && store->velocity_y[i] > 0.0f))
+        {
+            store->velocity_y[i] = -store->velocity_y[i];
+        }
+    }
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int count_overlaps(const EntityStore *store, const std::vector<CollisionPair> &pairs)
+{
+    int overlap_count = 0;
+    for (size_t i = 0; i < pairs.size(); i++) overlap_count += overlaps(store, pairs[i].a, pairs[i].b);
+    return overlap_count;
+}
+
+// Runs every broadphase over the same crowd, each step, and prints how long each one took.
+// Returns false if any of them found a different number of overlaps than the others
+bool run(int entity_count, int step_count, float world_width, float world_height)
+{
+    bool brute_force = entity_count <= BRUTE_FORCE_LIMIT,
+         all_agree   = true;
+    
+    EntityStore store;
+    fill(&store, entity_count, world_width, world_height);
+    
+    SpatialGrid grid;
+    grid.initialise(GRID_CELL_SIZE);
+    SweepAndPrune sweep;
+    AABBTree tree;
+    tree.initialise(TREE_MARGIN);
+    std::vector<CollisionPair> pairs;
+    
+    double grid_milliseconds  = 0.0,
+           sweep_milliseconds = 0.0,
+           tree_milliseconds  = 0.0,
+           brute_milliseconds = 0.0;
+    long   overlap_count      = 0,
+           refiled_count      = 0,
+           swap_count         = 0;
+    
+    // Every broadphase sorts or files everything from scratch the first time, which isn't what
+    // we're measuring, so that step is left out of the times
+    grid.update(&store);
+    sweep.update(&store);
+    tree.update(&store);
+    
+    for (int step = 0; step < step_count; step++)
+    {
+        store.integrate(FIXED_TIMESTEP);
+        bounce(&store, world_width, world_height);
+    
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        grid.update(&store);
+        grid.find_pairs(pairs);
+        int grid_overlaps = count_overlaps(&store, pairs);
+        grid_milliseconds += milliseconds_since(start);
+    
+        start = std::chrono::steady_clock::now();
+        sweep.update(&store);
+        sweep.find_pairs(pairs);
+        int sweep_overlaps = count_overlaps(&store, pairs);
+        sweep_milliseconds += milliseconds_since(start);
+    
+        start = std::chrono::steady_clock::now();
+        tree.update(&store);
+        tree.find_pairs(pairs);
+        int tree_overlaps = count_overlaps(&store, pairs);
+        tree_milliseconds += milliseconds_since(start);
+    
+        overlap_count += grid_overlaps;
+        refiled_count += grid.get_refiled_count();
+        swap_count    += sweep.get_swap_count();
+    
+        if (sweep_overlaps != grid_overlaps || tree_overlaps != grid_overlaps) all_agree = false;
+        if (!brute_force) continue;
+    
+        start = std::chrono::steady_clock::now();
+        int brute_overlaps = 0;
+        for (int a = 0; a < entity_count; a++)
+        {
+            for (int b = a + 1; b < entity_count; b++) brute_overlaps += overlaps(&store, a, b);
+        }
+        brute_milliseconds += milliseconds_since(start);
+    
+        if (brute_overlaps != grid_overlaps) all_agree = false;
+    }
+    
+    std::cout << "  " << entity_count << " entities (" << overlap_count / step_count << " overlaps): grid "
+              << grid_milliseconds / step_count << " ms (" << refiled_count / step_count << " changed cells), sweep and prune "
+              << sweep_milliseconds / step_count << " ms (" << swap_count / step_count << " swaps), tree "
+              << tree_milliseconds / step_count << " ms";
+    if (brute_force) std::cout << ", every pair " << brute_milliseconds / step_count << " ms";
+    std::cout << '\n';
+    
+    return all_agree;
+}
+
+int main(int argc, char* argv[])
+{
+    int largest_count = argc > 1 ? atoi(argv[1]) : DEFAULT_ENTITY_COUNT;
+    int step_count    = argc > 2 ? atoi(argv[2]) : DEFAULT_STEP_COUNT;
+    bool all_agree    = true;
+    
+    LOG(step_count << " steps per run, times are per step");
+    
+    LOG("Square:");
+    for (int scale = SCALING_STEPS - 1; scale >= 0; scale--)
+    {
+        int   entity_count = largest_count >> scale;
+        float world_size   = sqrtf(entity_count / ENTITIES_PER_AREA);
+        all_agree = run(entity_count, step_count, world_size, world_size) && all_agree;
+    }
+    
+    LOG("Strip " << LEVEL_HEIGHT << " units tall:");
+    for (int scale = SCALING_STEPS - 1; scale >= 0; scale--)
+    {
+        int   entity_count = largest_count >> scale;
+        float world_width  = entity_count / ENTITIES_PER_AREA / LEVEL_HEIGHT;
+        all_agree = run(entity_count, step_count, world_width, LEVEL_HEIGHT) && all_agree;
+    }
+    
+    if (!all_agree) LOG("The broadphases disagreed on the number of overlaps!");
+    return all_agree ? 0 : 1;
+}
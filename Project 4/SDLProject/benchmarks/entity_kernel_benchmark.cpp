@@ -0,0 +1,145 @@
+/**
+* Entity kernel benchmark
+*
+* Runs the same crowd through every EntityKernels instruction set this CPU supports and
+* reports the time per step of each kernel, then checks that every one of them ended up with
+* exactly the same bits as the plain C++ version:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/entity_kernel_benchmark.cpp EntityStore.cpp EntityKernels.cpp -o entity_kernel_benchmark
+*   ./entity_kernel_benchmark [entities] [steps]
+*
+* Entity counts that aren't a multiple of eight also cover the slots left over after the last batch.
+**/
+
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "EntityStore.h"
+#include "EntityKernels.h"
+
+const int DEFAULT_ENTITY_COUNT = 100000,
+          DEFAULT_STEP_COUNT   = 600;
+
+const float FIXED_TIMESTEP = 1.0f / 60.0f,
+            FRAME_DURATION = 0.25f;
+
+const InstructionSet INSTRUCTION_SETS[] = { SCALAR_INSTRUCTIONS, SSE2_INSTRUCTIONS, AVX2_INSTRUCTIONS, NEON_INSTRUCTIONS };
+const int INSTRUCTION_SET_COUNT = sizeof(INSTRUCTION_SETS) / sizeof(INSTRUCTION_SETS[0]);
+
+struct Result
+{
+    EntityStore store;
+    std::vector<unsigned char> hits;
+    long   hit_count = 0;
+    double integrate_milliseconds = 0.0,
+           animate_milliseconds   = 0.0,
+           overlap_milliseconds   = 0.0;
+};
+
+// A spread-out crowd where some stand still, some have no walk cycle and a few aren't moving sideways
+void fill(EntityStore *store, int entity_count)
+{
+    store->reserve(entity_count);
+    
+    for (int i = 0; i < entity_count; i++)
+    {
+        int index = store->add();
+        store->position_x[index]       = -50.0f + (i % 1000) * 0.1f;
+        store->position_y[index]       = -50.0f + ((i / 1000) % 1000) * 0.1f;
+        store->previous_x[index]       = store->position_x[index];
+        store->previous_y[index]       = store->position_y[index];
+        store->movement_x[index]       = (i % 3 == 0) ? 0.0f : ((i % 2 == 0) ? 1.0f : -1.0f);
+        store->movement_y[index]       = (i % 11 == 0) ? 0.7f : 0.0f;
+        store->speed[index]            = 1.0f + (i % 7) * 0.25f;
+        store->acceleration_y[index]   = -9.81f;
+        store->width[index]            = 0.5f + (i % 5) * 0.1f;
+        store->height[index]           = 0.5f + (i % 3) * 0.2f;
+        store->animation_frames[index] = (i % 4 == 0) ? 0 : 4;
+        store->animation_time[index]   = (i % 15) * FIXED_TIMESTEP;
+    }
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void run(Result *result, int entity_count, int step_count)
+{
+    fill(&result->store, entity_count);
+    result->hits.assign(entity_count, 0);
+    
+    for (int step = 0; step < step_count; step++)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        result->store.integrate(FIXED_TIMESTEP);
+        result->integrate_milliseconds += milliseconds_since(start);
+    
+        start = std::chrono::steady_clock::now();
+        EntityKernels::advance_animations(&result->store, FIXED_TIMESTEP, FRAME_DURATION);
+        result->animate_milliseconds += milliseconds_since(start);
+    
+        // A box around someone different in the crowd every step
+        int   target = (step * 7919) % entity_count;
+        float x      = result->store.position_x[target],
+              y      = result->store.position_y[target];
+        
+        start = std::chrono::steady_clock::now();
+        result->hit_count += EntityKernels::find_overlaps(&result->store, x, y, 2.0f, 2.0f, result->hits.data());
+        result->overlap_milliseconds += milliseconds_since(start);
+    }
+}
+
+template <typename T>
+bool same_bits(const std::vector<T> &a, const std::vector<T> &b)
+{
+    return a.size() == b.size() && memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0;
+}
+
+bool same_bits(const Result &a, const Result &b)
+{
+    return same_bits(a.store.position_x, b.store.position_x) && same_bits(a.store.position_y, b.store.position_y) &&
+           same_bits(a.store.previous_x, b.store.previous_x) && same_bits(a.store.previous_y, b.store.previous_y) &&
+           same_bits(a.store.velocity_x, b.store.velocity_x) && same_bits(a.store.velocity_y, b.store.velocity_y) &&
+           same_bits(a.store.animation_time,  b.store.animation_time)  &&
+           same_bits(a.store.animation_index, b.store.animation_index) &&
+           same_bits(a.hits, b.hits) && a.hit_count == b.hit_count;
+}
+
+int main(int argc, char* argv[])
+{
+    int entity_count = argc > 1 ? atoi(argv[1]) : DEFAULT_ENTITY_COUNT;
+    int step_count   = argc > 2 ? atoi(argv[2]) : DEFAULT_STEP_COUNT;
+    
+    LOG(entity_count << " entities, " << step_count << " steps, picked " << EntityKernels::get_name(EntityKernels::get_instruction_set()));
+    
+    Result scalar;
+    bool all_match = true;
+    
+    for (int i = 0; i < INSTRUCTION_SET_COUNT; i++)
+    {
+        if (!EntityKernels::select(INSTRUCTION_SETS[i])) continue;
+    
+        Result result;
+        run(&result, entity_count, step_count);
+    
+        bool matches = true;
+        if (INSTRUCTION_SETS[i] == SCALAR_INSTRUCTIONS) scalar = result;
+        else                                             matches = same_bits(result, scalar);
+        all_match = all_match && matches;
+    
+        LOG(EntityKernels::get_name(INSTRUCTION_SETS[i]) << ": "
+            << "integrate " << result.integrate_milliseconds / step_count << " ms, "
+            << "animate "   << result.animate_milliseconds   / step_count << " ms, "
+            << "overlap "   << result.overlap_milliseconds   / step_count << " ms per step, "
+            << result.hit_count << " hits"
+            << (matches ? "" : "  <-- DOES NOT MATCH SCALAR"));
+    }
+    
+    return all_match ? 0 : 1;
+}
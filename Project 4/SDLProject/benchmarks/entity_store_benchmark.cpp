@@ -0,0 +1,201 @@
+/**
+* Entity store benchmark
+*
+* Steps a crowd of entities through the kinematic part of a fixed step (velocity from movement
+* and acceleration, then position from velocity) three ways, and reports the time per step:
+*
+*   aos     - entities laid out the way Entity used to be, each one allocated on its own with new
+*   handles - one slot at a time through EntityKernels, which is what Entity::update does now
+*   soa     - the whole store at once with EntityStore::integrate
+*
+* Collisions are left out on purpose; they cost the same whichever way the fields are stored.
+* Nothing is drawn, so this one doesn't need a GL context:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/entity_store_benchmark.cpp EntityStore.cpp EntityKernels.cpp $(sdl2-config --cflags) -o entity_store_benchmark
+*   ./entity_store_benchmark [entities] [steps]
+**/
+
+#define GL_SILENCE_DEPRECATION
+#define GL_GLEXT_PROTOTYPES 1
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "EntityStore.h"
+#include "EntityKernels.h"
+
+const int DEFAULT_ENTITY_COUNT = 100000,
+          DEFAULT_STEP_COUNT   = 600;
+
+const float FIXED_TIMESTEP = 1.0f / 60.0f;
+
+// Entity's fields before the kinematics moved into EntityStore, in the same order,
+// so every entity drags the same amount of memory through the cache as it used to
+struct AtlasRegion { float u, v, width, height; };
+
+class LegacyEntity
+{
+public:
+    bool m_is_active = true;
+    int  m_entity_type, m_ai_type, m_ai_state;
+    
+    int *m_animation_right = NULL;
+    int *m_animation_left  = NULL;
+    int *m_animation_up    = NULL;
+    int *m_animation_down  = NULL;
+    
+    glm::vec3 m_position;
+    glm::vec3 m_previous_position;
+    glm::vec3 m_velocity;
+    glm::vec3 m_acceleration;
+    
+    float m_width  = 0.8f;
+    float m_height = 0.8f;
+    
+    GLuint m_texture_id = 0;
+    AtlasRegion m_texture_region;
+    glm::mat4 m_model_matrix;
+    
+    float m_speed;
+    glm::vec3 m_movement;
+    
+    int **m_walking          = new int*[4] { m_animation_left, m_animation_right, m_animation_up, m_animation_down };
+    int *m_animation_indices = NULL;
+    int m_animation_frames   = 0;
+    int m_animation_index    = 0;
+    float m_animation_time   = 0.0f;
+    int m_animation_cols     = 0;
+    int m_animation_rows     = 0;
+    
+    bool m_is_jumping     = false;
+    float m_jumping_power = 0;
+    
+    bool m_collided_top    = false;
+    bool m_collided_bottom = false;
+    bool m_collided_left   = false;
+    bool m_collided_right  = false;
+    
+    ~LegacyEntity() { delete [] m_walking; }
+    
+    // The lines of the old Entity::update that EntityStore::integrate replaces
+    void integrate(float delta_time)
+    {
+        m_previous_position = m_position;
+    
+        m_velocity.x = m_movement.x * m_speed;
+        m_velocity  += m_acceleration * delta_time;
+    
+        m_position.y += m_velocity.y * delta_time;
+        m_position.x += m_velocity.x * delta_time;
+    }
+};
+
+// Spread the crowd out and give everyone a slightly different walk, so no two slots hold the same numbers
+void starting_state(int i, float *position_x, float *position_y, float *movement_x, float *speed)
+{
+    *position_x = -4.5f + (i % 100) * 0.09f;
+    *position_y = -3.5f + ((i / 100) % 100) * 0.07f;
+    *movement_x = (i % 2 == 0) ? 1.0f : -1.0f;
+    *speed      = 1.0f + (i % 7) * 0.25f;
+}
+
+double milliseconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char* argv[])
+{
+    int entity_count = argc > 1 ? atoi(argv[1]) : DEFAULT_ENTITY_COUNT;
+    int step_count   = argc > 2 ? atoi(argv[2]) : DEFAULT_STEP_COUNT;
+    
+    // ————— AOS ————— //
+    std::vector<LegacyEntity*> legacy_entities;
+    for (int i = 0; i < entity_count; i++)
+    {
+        LegacyEntity *entity = new LegacyEntity();
+        float position_x, position_y, movement_x, speed;
+        starting_state(i, &position_x, &position_y, &movement_x, &speed);
+    
+        entity->m_position          = glm::vec3(position_x, position_y, 0.0f);
+        entity->m_previous_position = entity->m_position;
+        entity->m_velocity          = glm::vec3(0.0f);
+        entity->m_acceleration      = glm::vec3(0.0f, -9.81f, 0.0f);
+        entity->m_movement          = glm::vec3(movement_x, 0.0f, 0.0f);
+        entity->m_speed             = speed;
+        entity->m_model_matrix      = glm::mat4(1.0f);
+    
+        legacy_entities.push_back(entity);
+    }
+    
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int step = 0; step < step_count; step++)
+    {
+        for (int i = 0; i < entity_count; i++) legacy_entities[i]->integrate(FIXED_TIMESTEP);
+    }
+    double aos_milliseconds = milliseconds_since(start);
+    
+    // ————— SOA ————— //
+    EntityStore store;
+    store.reserve(entity_count);
+    
+    for (int i = 0; i < entity_count; i++)
+    {
+        int index = store.add();
+        starting_state(i, &store.position_x[index], &store.position_y[index], &store.movement_x[index], &store.speed[index]);
+        store.previous_x[index]     = store.position_x[index];
+        store.previous_y[index]     = store.position_y[index];
+        store.acceleration_y[index] = -9.81f;
+    }
+    
+    // An identical copy, to step a slot at a time
+    EntityStore handle_store = store;
+    
+    start = std::chrono::steady_clock::now();
+    for (int step = 0; step < step_count; step++)
+    {
+        for (int i = 0; i < entity_count; i++)
+        {
+            handle_store.previous_x[i] = handle_store.position_x[i];
+            handle_store.previous_y[i] = handle_store.position_y[i];
+            EntityKernels::integrate_velocity(&handle_store, i, FIXED_TIMESTEP);
+            EntityKernels::integrate_position_y(&handle_store, i, FIXED_TIMESTEP);
+            EntityKernels::integrate_position_x(&handle_store, i, FIXED_TIMESTEP);
+        }
+    }
+    double handle_milliseconds = milliseconds_since(start);
+    
+    start = std::chrono::steady_clock::now();
+    for (int step = 0; step < step_count; step++) store.integrate(FIXED_TIMESTEP);
+    double soa_milliseconds = milliseconds_since(start);
+    
+    // ————— RESULTS ————— //
+    // All three should land everyone in the same place; this also keeps the loops from being optimised away
+    float largest_difference = 0.0f;
+    for (int i = 0; i < entity_count; i++)
+    {
+        glm::vec3 position = legacy_entities[i]->m_position;
+        largest_difference = fmaxf(largest_difference, fabsf(position.x - store.position_x[i]));
+        largest_difference = fmaxf(largest_difference, fabsf(position.y - store.position_y[i]));
+        largest_difference = fmaxf(largest_difference, fabsf(handle_store.position_x[i] - store.position_x[i]));
+        largest_difference = fmaxf(largest_difference, fabsf(handle_store.position_y[i] - store.position_y[i]));
+    }
+    
+    LOG(entity_count << " entities, " << step_count << " steps");
+    LOG("aos:     " << aos_milliseconds    / step_count << " ms per step");
+    LOG("handles: " << handle_milliseconds / step_count << " ms per step (" << aos_milliseconds / handle_milliseconds << "x)");
+    LOG("soa:     " << soa_milliseconds    / step_count << " ms per step (" << aos_milliseconds / soa_milliseconds    << "x)");
+    LOG("largest difference in position: " << largest_difference);
+    
+    for (int i = 0; i < entity_count; i++) delete legacy_entities[i];
+    
+    return 0;
+}
@@ -0,0 +1,168 @@
+/**
+* Map culling benchmark
+*
+* Builds a 4096x4096-tile level and scrolls the camera across it from left to right,
+* reporting the average frame time and visible chunk count for each stretch of the level.
+* With chunk culling the numbers should stay flat no matter how large the level is.
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/map_culling_benchmark.cpp Map.cpp Quad.cpp ShaderProgram.cpp RenderState.cpp \
+*       $(sdl2-config --cflags --libs) -lGL -o map_culling_benchmark
+*   SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./map_culling_benchmark [width] [height] [frames] [--separate-matrices]
+*
+* --separate-matrices loads shaders/vertex_textured.glsl, which multiplies all three matrices for every
+* vertex, instead of shaders/vertex_textured_mvp.glsl.
+**/
+
+#define GL_SILENCE_DEPRECATION
+#define GL_GLEXT_PROTOTYPES 1
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "ShaderProgram.h"
+#include "Map.h"
+
+const int WINDOW_WIDTH  = 640,
+          WINDOW_HEIGHT = 480;
+
+const char V_SHADER_PATH[] = "shaders/vertex_textured_mvp.glsl",
+           F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+           V_SEPARATE_SHADER_PATH[] = "shaders/vertex_textured.glsl";
+
+const int DEFAULT_LEVEL_WIDTH  = 4096,
+          DEFAULT_LEVEL_HEIGHT = 4096,
+          DEFAULT_FRAME_COUNT  = 2048,
+          SEGMENT_COUNT        = 8;
+
+// How many solid tiles sit under the surface; anything deeper is left empty so
+// the level stays big without eating all of our memory
+const int GROUND_DEPTH = 4;
+
+GLuint make_tileset_texture()
+{
+    const int width = 16, height = 4;
+    unsigned char pixels[width * height * 4];
+    
+    for (int i = 0; i < width * height; i++)
+    {
+        pixels[i * 4 + 0] = (unsigned char) ((i % width) * 16);
+        pixels[i * 4 + 1] = 160;
+        pixels[i * 4 + 2] = 64;
+        pixels[i * 4 + 3] = 255;
+    }
+    
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    return texture_id;
+}
+
+// Rolling hills, with a floating platform every so often
+int surface_row(int x_coord, int height)
+{
+    return height / 2 + (int) (sin(x_coord * 0.05f) * 6.0f + sin(x_coord * 0.011f) * 20.0f);
+}
+
+int main(int argc, char* argv[])
+{
+    int level_width  = argc > 1 ? atoi(argv[1]) : DEFAULT_LEVEL_WIDTH;
+    int level_height = argc > 2 ? atoi(argv[2]) : DEFAULT_LEVEL_HEIGHT;
+    int frame_count  = argc > 3 ? atoi(argv[3]) : DEFAULT_FRAME_COUNT;
+    bool separate_matrices = argc > 4 && strcmp(argv[4], "--separate-matrices") == 0;
+    
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Window *window = SDL_CreateWindow("Map culling benchmark", 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                          SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == NULL)
+    {
+        LOG("Unable to create window: " << SDL_GetError());
+        return 1;
+    }
+    
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    SDL_GL_MakeCurrent(window, context);
+    SDL_GL_SetSwapInterval(0);
+    
+    LOG("Renderer: " << glGetString(GL_RENDERER));
+    LOG("Matrices:          " << (separate_matrices ? "separate" : "combined"));
+    
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    ShaderProgram program;
+    program.Load(separate_matrices ? V_SEPARATE_SHADER_PATH : V_SHADER_PATH, F_SHADER_PATH);
+    
+    glm::mat4 projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
+    program.SetProjectionMatrix(projection_matrix);
+    
+    std::vector<unsigned int> level_data((size_t) level_width * level_height, 0);
+    for (int x_coord = 0; x_coord < level_width; x_coord++)
+    {
+        int surface = surface_row(x_coord, level_height);
+        
+        for (int y_coord = surface; y_coord < surface + GROUND_DEPTH && y_coord < level_height; y_coord++)
+        {
+            level_data[(size_t) y_coord * level_width + x_coord] = y_coord == surface ? 1 : 2;
+        }
+        
+        if (x_coord % 12 < 4 && surface - 3 >= 0) level_data[(size_t) (surface - 3) * level_width + x_coord] = 1;
+    }
+    
+    Uint64 frequency   = SDL_GetPerformanceFrequency();
+    Uint64 build_start = SDL_GetPerformanceCounter();
+    
+    Map *map = new Map(level_width, level_height, level_data.data(), make_tileset_texture(), 1.0f, 4, 1);
+    
+    LOG("Level:             " << level_width << "x" << level_height << " tiles, " << map->get_chunk_count() << " chunks");
+    LOG("Build ms:          " << 1000.0 * (SDL_GetPerformanceCounter() - build_start) / frequency);
+    
+    // Scroll across the whole level, following the ground like the player would
+    Uint64 segment_ticks[SEGMENT_COUNT] = { 0 };
+    long   segment_chunks[SEGMENT_COUNT] = { 0 };
+    int    segment_frames[SEGMENT_COUNT] = { 0 };
+    
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        float camera_x = (float) frame / frame_count * (level_width - 1);
+        float camera_y = -(float) surface_row((int) camera_x, level_height);
+        
+        glm::mat4 view_matrix = glm::translate(glm::mat4(1.0f), glm::vec3(-camera_x, -camera_y, 0.0f));
+        program.SetViewMatrix(view_matrix);
+        
+        Uint64 start = SDL_GetPerformanceCounter();
+        
+        glClear(GL_COLOR_BUFFER_BIT);
+        map->render(&program, view_matrix, projection_matrix);
+        glFinish();
+        
+        int segment = frame * SEGMENT_COUNT / frame_count;
+        segment_ticks[segment]  += SDL_GetPerformanceCounter() - start;
+        segment_chunks[segment] += map->get_visible_chunk_count();
+        segment_frames[segment]++;
+    }
+    
+    for (int segment = 0; segment < SEGMENT_COUNT; segment++)
+    {
+        if (segment_frames[segment] == 0) continue;
+        
+        LOG("Segment " << segment << ": "
+            << 1000.0 * segment_ticks[segment] / frequency / segment_frames[segment] << " ms/frame, "
+            << (double) segment_chunks[segment] / segment_frames[segment] << " chunks drawn");
+    }
+    
+    delete map;
+    program.Cleanup();
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,197 @@
+/**
+* Shader cache benchmark
+*
+* Times how long Project 4's shader programs take to get ready at start-up, first with an
+* empty cache (compile and link from source, then save the binaries) and then with a warm
+* one (hand the saved binaries straight to the driver):
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/shader_cache_benchmark.cpp ShaderProgram.cpp \
+*       $(sdl2-config --cflags --libs) -lGL -o shader_cache_benchmark
+*   SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./shader_cache_benchmark [launches]
+*
+* Every launch is its own process with its own GL context, like the game starting up, and
+* only its first load of each program is timed. Anything the driver remembers inside a
+* process would otherwise make every launch after the first look warm.
+*
+* Each cold launch also starts from empty folders, both for our binaries and for Mesa's own
+* on-disk shader cache (through MESA_SHADER_CACHE_DIR), and the warm launch after it reuses
+* them. Mesa only offers program binaries while that cache is switched on; with
+* MESA_SHADER_CACHE_DISABLE=true no binary formats are offered and both launches compile
+* from source. POSIX only, since launches are started with fork and exec.
+**/
+
+#define GL_SILENCE_DEPRECATION
+#define GL_GLEXT_PROTOTYPES 1
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <ftw.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ShaderProgram.h"
+
+const int WINDOW_WIDTH  = 640,
+          WINDOW_HEIGHT = 480;
+
+const int DEFAULT_LAUNCH_COUNT = 20;
+
+// The same programs main.cpp loads
+const char *SHADER_PATHS[][2] =
+{
+    { "shaders/vertex_textured_mvp.glsl", "shaders/fragment_textured.glsl" },
+    { "shaders/vertex_instanced.glsl",    "shaders/fragment_textured.glsl" }
+};
+const int PROGRAM_COUNT = sizeof(SHADER_PATHS) / sizeof(SHADER_PATHS[0]);
+
+// What a launch process passes back to us on its standard output
+struct LaunchResult
+{
+    double elapsed_ms;
+    int    cached_count;
+};
+
+// Runs in the launch process: opens a window and context like the game, then loads every
+// program once and prints how long that took and how many came from the cache
+int run_launch(const char *cache_directory)
+{
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Window *window = SDL_CreateWindow("Shader cache benchmark", 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                          SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == NULL)
+    {
+        std::cerr << "Unable to create window: " << SDL_GetError() << '\n';
+        return 1;
+    }
+    
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    SDL_GL_MakeCurrent(window, context);
+    
+    ShaderProgram::cacheDirectory = cache_directory;
+    
+    ShaderProgram programs[PROGRAM_COUNT];
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start     = SDL_GetPerformanceCounter();
+    
+    int cached_count = 0;
+    for (int i = 0; i < PROGRAM_COUNT; i++)
+    {
+        programs[i].Load(SHADER_PATHS[i][0], SHADER_PATHS[i][1]);
+        if (programs[i].loadedFromCache) cached_count++;
+    }
+    
+    // Make sure the driver has really finished with them before we stop the clock
+    glFinish();
+    
+    double elapsed_ms = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+    
+    for (int i = 0; i < PROGRAM_COUNT; i++) programs[i].Cleanup();
+    
+    std::cout << elapsed_ms << ' ' << cached_count << '\n';
+    
+    SDL_GL_DeleteContext(context);
+    SDL_Quit();
+    return 0;
+}
+
+int remove_entry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return remove(path);
+}
+
+// Deletes the folder and everything in it, then makes it again empty
+void empty_directory(const std::string &path)
+{
+    nftw(path.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    mkdir(path.c_str(), 0755);
+}
+
+// Starts this program again as a launch process and reads back what it measured
+bool launch(const char *executable, const std::string &cache_directory, LaunchResult *result)
+{
+    int output[2];
+    if (pipe(output) != 0) return false;
+    
+    pid_t child = fork();
+    if (child == 0)
+    {
+        dup2(output[1], STDOUT_FILENO);
+        close(output[0]);
+        close(output[1]);
+        execl(executable, executable, "--launch", cache_directory.c_str(), (char *) NULL);
+        _exit(127);
+    }
+    
+    close(output[1]);
+    
+    std::string text;
+    char buffer[256];
+    ssize_t count;
+    while ((count = read(output[0], buffer, sizeof(buffer))) > 0) text.append(buffer, count);
+    close(output[0]);
+    
+    int status = 0;
+    if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return false;
+    
+    return sscanf(text.c_str(), "%lf %d", &result->elapsed_ms, &result->cached_count) == 2;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc > 2 && strcmp(argv[1], "--launch") == 0) return run_launch(argv[2]);
+    
+    int launch_count = argc > 1 ? atoi(argv[1]) : DEFAULT_LAUNCH_COUNT;
+    
+    char scratch_template[] = "/tmp/shader_cache_benchmark.XXXXXX";
+    if (mkdtemp(scratch_template) == NULL)
+    {
+        LOG("Unable to make a scratch folder.");
+        return 1;
+    }
+    
+    std::string scratch_directory = scratch_template,
+                cache_directory   = scratch_directory + "/programs/",
+                mesa_directory    = scratch_directory + "/mesa";
+    
+    // Launch processes inherit this, so Mesa keeps its cache where we can empty it
+    setenv("MESA_SHADER_CACHE_DIR", mesa_directory.c_str(), 1);
+    
+    double cold_ms = 0.0,
+           warm_ms = 0.0;
+    int cold_cached = 0,
+        warm_cached = 0;
+    
+    for (int i = 0; i < launch_count; i++)
+    {
+        empty_directory(cache_directory);
+        empty_directory(mesa_directory);
+    
+        LaunchResult cold, warm;
+        if (!launch(argv[0], cache_directory, &cold) || !launch(argv[0], cache_directory, &warm))
+        {
+            LOG("A launch process failed.");
+            nftw(scratch_directory.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+            return 1;
+        }
+    
+        cold_ms     += cold.elapsed_ms;
+        cold_cached += cold.cached_count;
+        warm_ms     += warm.elapsed_ms;
+        warm_cached += warm.cached_count;
+    }
+    
+    nftw(scratch_directory.c_str(), remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    
+    LOG("Programs:          " << PROGRAM_COUNT);
+    LOG("Cold launch ms:    " << cold_ms / launch_count << " (" << cold_cached << " of " << launch_count * PROGRAM_COUNT << " loaded from cache)");
+    LOG("Warm launch ms:    " << warm_ms / launch_count << " (" << warm_cached << " of " << launch_count * PROGRAM_COUNT << " loaded from cache)");
+    
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+* Sprite batch benchmark
+*
+* Renders a crowd of animated entities through the SpriteBatch (or the instanced renderer)
+* and reports draw calls and frame time. Meant to run on a display-less box through Mesa's software rasteriser:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. benchmarks/sprite_batch_benchmark.cpp Entity.cpp EntityStore.cpp EntityKernels.cpp AABBTree.cpp Map.cpp Quad.cpp ShaderProgram.cpp \
+*       SpriteBatch.cpp InstancedSpriteRenderer.cpp RenderState.cpp StreamBuffer.cpp $(sdl2-config --cflags --libs) -lGL -o sprite_batch_benchmark
+*   SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 ./sprite_batch_benchmark [entities] [frames] [--unbatched | --instanced] [--stream]
+*
+* --unbatched flushes after every entity, which is what Entity::render used to cost.
+* --instanced draws through InstancedSpriteRenderer and shaders/vertex_instanced.glsl.
+* --stream sends the vertices (or instances) through a StreamBuffer instead of client memory.
+**/
+
+#define GL_SILENCE_DEPRECATION
+#define GL_GLEXT_PROTOTYPES 1
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteRenderer.h"
+#include "Entity.h"
+#include "Map.h"
+
+const int WINDOW_WIDTH  = 640,
+          WINDOW_HEIGHT = 480;
+
+const char V_SHADER_PATH[] = "shaders/vertex_textured_mvp.glsl",
+           F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+           V_INSTANCED_SHADER_PATH[] = "shaders/vertex_instanced.glsl";
+
+const int DEFAULT_ENTITY_COUNT = 10000,
+          DEFAULT_FRAME_COUNT  = 300;
+
+const float FIXED_TIMESTEP = 0.0166666f;
+
+// A 4x4 sheet of flat-coloured frames, so we don't need any files besides the shaders
+GLuint make_checker_texture()
+{
+    const int size = 16;
+    unsigned char pixels[size * size * 4];
+    
+    for (int y = 0; y < size; y++)
+    {
+        for (int x = 0; x < size; x++)
+        {
+            unsigned char *pixel = &pixels[(y * size + x) * 4];
+            pixel[0] = (unsigned char) (x * 16);
+            pixel[1] = (unsigned char) (y * 16);
+            pixel[2] = 128;
+            pixel[3] = 255;
+        }
+    }
+    
+    GLuint texture_id;
+    glGenTextures(1, &texture_id);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    
+    return texture_id;
+}
+
+int main(int argc, char* argv[])
+{
+    int entity_count = DEFAULT_ENTITY_COUNT;
+    int frame_count  = DEFAULT_FRAME_COUNT;
+    bool unbatched   = false;
+    bool instanced   = false;
+    bool stream      = false;
+    
+    int positional = 0;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--unbatched") == 0)      unbatched = true;
+        else if (strcmp(argv[i], "--instanced") == 0) instanced = true;
+        else if (strcmp(argv[i], "--stream") == 0)    stream    = true;
+        else if (positional++ == 0)              entity_count = atoi(argv[i]);
+        else                                     frame_count  = atoi(argv[i]);
+    }
+    
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Window *window = SDL_CreateWindow("SpriteBatch benchmark", 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                          SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == NULL)
+    {
+        LOG("Unable to create window: " << SDL_GetError());
+        return 1;
+    }
+    
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    SDL_GL_MakeCurrent(window, context);
+    SDL_GL_SetSwapInterval(0);
+    
+    LOG("Renderer: " << glGetString(GL_RENDERER));
+    
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    ShaderProgram program;
+    program.Load(V_SHADER_PATH, F_SHADER_PATH);
+    program.SetProjectionMatrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+    program.SetViewMatrix(glm::mat4(1.0f));
+    
+    ShaderProgram instanced_program;
+    instanced_program.Load(V_INSTANCED_SHADER_PATH, F_SHADER_PATH);
+    instanced_program.SetProjectionMatrix(glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f));
+    instanced_program.SetViewMatrix(glm::mat4(1.0f));
+    
+    StreamBuffer stream_buffer;
+    if (stream) stream_buffer.initialise(QuadIndexBuffer::MAX_QUADS * VERTICES_PER_QUAD * sizeof(SpriteVertex));
+    
+    InstancedSpriteRenderer instanced_renderer;
+    instanced_renderer.initialise(&instanced_program, stream ? &stream_buffer : NULL);
+    
+    if (instanced && !instanced_renderer.is_supported())
+    {
+        LOG("GL_ARB_instanced_arrays and GL_ARB_draw_instanced are not both supported by this context.");
+        return 1;
+    }
+    
+    RenderState::invalidate();
+    RenderState::set_blend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    GLuint texture_id = make_checker_texture();
+    
+    // An empty level, so the entities only pay for the collision probes
+    std::vector<unsigned int> level_data(4, 0);
+    Map *map = new Map(2, 2, level_data.data(), texture_id, 1.0f, 4, 1);
+    
+    EntityStore store;
+    std::vector<Entity*> entities;
+    for (int i = 0; i < entity_count; i++)
+    {
+        Entity *entity = new Entity(&store);
+        entity->set_entity_type(PLAYER);
+        entity->set_position(glm::vec3(-4.5f + (i % 100) * 0.09f, -3.5f + ((i / 100) % 100) * 0.07f, 0.0f));
+        entity->set_movement(glm::vec3(1.0f, 0.0f, 0.0f));
+        entity->set_speed(0.0f);
+        entity->m_texture_id = texture_id;
+        
+        entity->m_walking[entity->RIGHT] = new int[4] { 3, 7, 11, 15 };
+        entity->m_animation_indices = entity->m_walking[entity->RIGHT];
+        entity->set_animation_frames(4);
+        entity->set_animation_index(i % 4);
+        entity->set_animation_time((i % 15) * FIXED_TIMESTEP);
+        entity->m_animation_cols    = 4;
+        entity->m_animation_rows    = 4;
+        
+        entities.push_back(entity);
+    }
+    
+    SpriteBatch batch;
+    
+    Uint64 frequency    = SDL_GetPerformanceFrequency();
+    Uint64 update_ticks = 0,
+           render_ticks = 0;
+    long   draw_calls   = 0,
+           state_issued = 0,
+           state_skipped = 0,
+           render_state_transitions = 0,
+           render_state_skipped     = 0;
+    
+    for (int frame = 0; frame < frame_count; frame++)
+    {
+        Uint64 start = SDL_GetPerformanceCounter();
+        
+        for (int i = 0; i < entity_count; i++) entities[i]->update(FIXED_TIMESTEP, NULL, NULL, 0, map);
+        
+        Uint64 middle = SDL_GetPerformanceCounter();
+        
+        ShaderProgram::ResetCallCounters();
+        RenderState::reset_counters();
+        glClear(GL_COLOR_BUFFER_BIT);
+        if (instanced)
+        {
+            instanced_renderer.begin();
+            for (int i = 0; i < entity_count; i++) entities[i]->render_instanced(&instanced_renderer);
+            instanced_renderer.end();
+        }
+        else
+        {
+            batch.begin(&program, stream ? &stream_buffer : NULL);
+            for (int i = 0; i < entity_count; i++)
+            {
+                entities[i]->render(&batch);
+                if (unbatched) batch.flush();
+            }
+            batch.end();
+        }
+        
+        if (stream) stream_buffer.end_frame();
+        
+        // Wait for the rasteriser, otherwise we'd only be timing how fast we can queue work
+        glFinish();
+        
+        Uint64 end = SDL_GetPerformanceCounter();
+        
+        update_ticks += middle - start;
+        render_ticks += end - middle;
+        draw_calls   += instanced ? instanced_renderer.get_draw_calls() : batch.get_draw_calls();
+        state_issued  += ShaderProgram::issuedCalls;
+        state_skipped += ShaderProgram::skippedCalls;
+        render_state_transitions += RenderState::get_transitions();
+        render_state_skipped     += RenderState::get_skipped();
+    }
+    
+    double update_ms = 1000.0 * update_ticks / frequency / frame_count;
+    double render_ms = 1000.0 * render_ticks / frequency / frame_count;
+    
+    LOG("Mode:              " << (instanced ? "instanced" : unbatched ? "unbatched" : "batched"));
+    LOG("Vertex source:     " << (!stream ? "client memory" : stream_buffer.is_persistent() ? "persistent stream buffer" : "orphaned stream buffer"));
+    LOG("Entities:          " << entity_count);
+    LOG("Frames:            " << frame_count);
+    LOG("Draw calls/frame:  " << (double) draw_calls / frame_count);
+    LOG("Program/uniform calls issued/frame:  " << (double) state_issued / frame_count);
+    LOG("Program/uniform calls skipped/frame: " << (double) state_skipped / frame_count);
+    LOG("Texture/attribute/blend calls issued/frame:  " << (double) render_state_transitions / frame_count);
+    LOG("Texture/attribute/blend calls skipped/frame: " << (double) render_state_skipped / frame_count);
+    LOG("Update ms/frame:   " << update_ms);
+    LOG("Render ms/frame:   " << render_ms);
+    LOG("Total ms/frame:    " << update_ms + render_ms);
+    
+    for (int i = 0; i < entity_count; i++) delete entities[i];
+    delete map;
+    instanced_renderer.cleanup();
+    if (stream) stream_buffer.cleanup();
+    instanced_program.Cleanup();
+    program.Cleanup();
+    SDL_GL_DeleteContext(context);
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
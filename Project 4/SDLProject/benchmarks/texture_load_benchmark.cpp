@@ -0,0 +1,144 @@
+/**
+* Texture load benchmark
+*
+* Times how long Project 4's images take to get from disk into the texture atlas at start-up,
+* the same add() and build() calls main.cpp makes, first decoding the PNGs and then from cooked
+* copies (memory-mapped RGBA, see CookedTexture.h). The copies are cooked the way the game's
+* are, without mipmaps, since the atlas only reads the full-size level. Run it from the folder
+* the images are in:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. -I../../Common benchmarks/texture_load_benchmark.cpp TextureAtlas.cpp ../../Common/CookedTexture.cpp \
+*       RenderState.cpp ShaderProgram.cpp $(sdl2-config --cflags --libs) -lGL -o texture_load_benchmark
+*   cd .. && SDL_VIDEODRIVER=offscreen LIBGL_ALWAYS_SOFTWARE=1 SDLProject/texture_load_benchmark [launches]
+*
+* The images are copied into a scratch folder first, so cooked files you already have are
+* left alone and the PNG launches can't pick them up by accident.
+**/
+
+#define GL_SILENCE_DEPRECATION
+#define GL_GLEXT_PROTOTYPES 1
+#define STB_IMAGE_IMPLEMENTATION
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <SDL.h>
+#include <SDL_opengl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "stb_image.h"
+#include "TextureAtlas.h"
+#include "RenderState.h"
+#include "CookedTexture.h"
+
+const int WINDOW_WIDTH  = 640,
+          WINDOW_HEIGHT = 480;
+
+const int DEFAULT_LAUNCH_COUNT = 20;
+
+// The same images main.cpp loads
+const char *IMAGE_FILEPATHS[] = { "tileset.png", "george_0.png", "soph.png", "font1.png" };
+const int IMAGE_COUNT = sizeof(IMAGE_FILEPATHS) / sizeof(IMAGE_FILEPATHS[0]);
+
+bool copy_file(const std::string &from, const std::string &to)
+{
+    std::ifstream source(from.c_str(), std::ios::binary);
+    std::ofstream destination(to.c_str(), std::ios::binary);
+    destination << source.rdbuf();
+    return source.good() && destination.good();
+}
+
+// Builds the atlas once, the way a launch would, and returns how long that took
+double launch(const std::string *filepaths, size_t *bytes)
+{
+    TextureAtlas atlas;
+    Uint64 frequency = SDL_GetPerformanceFrequency();
+    Uint64 start     = SDL_GetPerformanceCounter();
+    
+    for (int i = 0; i < IMAGE_COUNT; i++) atlas.add(filepaths[i].c_str());
+    GLuint texture_id = atlas.build();
+    
+    // Make sure the upload has really happened before we stop the clock
+    glFinish();
+    
+    double elapsed_ms = 1000.0 * (SDL_GetPerformanceCounter() - start) / frequency;
+    
+    *bytes = (size_t) atlas.get_width() * atlas.get_height() * 4;
+    glDeleteTextures(1, &texture_id);
+    
+    // Deleting the texture unbound it, and the next atlas is likely to get the same name back
+    RenderState::invalidate();
+    
+    return elapsed_ms;
+}
+
+int main(int argc, char* argv[])
+{
+    int launch_count = argc > 1 ? atoi(argv[1]) : DEFAULT_LAUNCH_COUNT;
+    
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_Window *window = SDL_CreateWindow("Texture load benchmark", 0, 0, WINDOW_WIDTH, WINDOW_HEIGHT,
+                                          SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (window == NULL)
+    {
+        LOG("Unable to create window: " << SDL_GetError());
+        return 1;
+    }
+    
+    SDL_GLContext context = SDL_GL_CreateContext(window);
+    SDL_GL_MakeCurrent(window, context);
+    
+    LOG("Renderer: " << glGetString(GL_RENDERER));
+    
+    char *pref_path = SDL_GetPrefPath("CS3113", "Texture load benchmark");
+    std::string scratch = pref_path != NULL ? pref_path : "./";
+    SDL_free(pref_path);
+    
+    std::string filepaths[IMAGE_COUNT];
+    for (int i = 0; i < IMAGE_COUNT; i++)
+    {
+        filepaths[i] = scratch + IMAGE_FILEPATHS[i];
+        remove(CookedTexture::get_cooked_path(filepaths[i].c_str()).c_str());
+        
+        if (!copy_file(IMAGE_FILEPATHS[i], filepaths[i]))
+        {
+            LOG("Unable to copy " << IMAGE_FILEPATHS[i] << "; run this from the folder the images are in");
+            return 1;
+        }
+    }
+    
+    double png_ms = 0.0;
+    size_t png_bytes = 0;
+    for (int i = 0; i < launch_count; i++) png_ms += launch(filepaths, &png_bytes);
+    
+    // The one-off cost we're moving out of start-up
+    Uint64 cook_start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < IMAGE_COUNT; i++)
+    {
+        int width, height;
+        unsigned char *pixels = stbi_load(filepaths[i].c_str(), &width, &height, NULL, STBI_rgb_alpha);
+        CookedTexture::cook(filepaths[i].c_str(), pixels, width, height, false);
+        stbi_image_free(pixels);
+    }
+    double cook_ms = 1000.0 * (SDL_GetPerformanceCounter() - cook_start) / SDL_GetPerformanceFrequency();
+    
+    double cooked_ms = 0.0;
+    size_t cooked_bytes = 0;
+    for (int i = 0; i < launch_count; i++) cooked_ms += launch(filepaths, &cooked_bytes);
+    
+    for (int i = 0; i < IMAGE_COUNT; i++)
+    {
+        remove(CookedTexture::get_cooked_path(filepaths[i].c_str()).c_str());
+        remove(filepaths[i].c_str());
+    }
+    
+    LOG("Images:            " << IMAGE_COUNT);
+    LOG("PNG launch ms:     " << png_ms / launch_count << " (" << png_bytes / 1024 << " KB atlas)");
+    LOG("Cooked launch ms:  " << cooked_ms / launch_count << " (" << cooked_bytes / 1024 << " KB atlas)");
+    LOG("One-off cook ms:   " << cook_ms);
+    
+    SDL_Quit();
+    return 0;
+}
@@ -21,17 +21,37 @@
 #include "cmath"
 #include <ctime>
 #include <vector>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <atomic>
 #include "Entity.h"
 #include "Map.h"
+#include "SpriteBatch.h"
+#include "InstancedSpriteRenderer.h"
+#include "TextureAtlas.h"
+#include "TextMesh.h"
+#include "RenderState.h"
+#include "RenderQueue.h"
+#include "FileWatcher.h"
+#include "HeadlessTarget.h"
+#include "FramePacer.h"
+#include "TripleBuffer.h"
+#include "SweepAndPrune.h"
 
 // ————— GAME STATE ————— //
 struct GameState
 {
+    EntityStore entities;  // Where the player's and enemies' positions and velocities actually live
     Entity *player;
     Entity *enemies[ENEMY_COUNT];
     
     Map *map;
     
+    GLuint font_texture_id;
+    AtlasRegion font_texture_region;
+    TextMesh *lose_text;
+    
     Mix_Music *bgm;
     Mix_Chunk *jump_sfx;
 };
@@ -52,21 +72,35 @@ const int VIEWPORT_X = 0,
 
 const char GAME_WINDOW_NAME[] = "Hello, Maps!";
 
-const char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-           F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+const char V_SHADER_PATH[] = "shaders/vertex_textured_mvp.glsl",
+           F_SHADER_PATH[] = "shaders/fragment_textured.glsl",
+           V_INSTANCED_SHADER_PATH[] = "shaders/vertex_instanced.glsl";
 
 const float MILLISECONDS_IN_SECOND = 1000.0;
 
+// Without vsync (or if the driver won't give it to us), the frame pacer sleeps us down to this rate
+const double TARGET_FRAME_RATE = 60.0;
+const bool   USE_VSYNC         = true;
+
 const char SPRITESHEET_FILEPATH[] = "george_0.png",
            ENEMY_FILEPATH[] = "soph.png",
            MAP_TILESET_FILEPATH[] = "tileset.png",
+           FONT_FILEPATH[]        = "font1.png",
            BGM_FILEPATH[]         = "dooblydoo.mp3",
-           JUMP_SFX_FILEPATH[]    = "bounce.wav";
-
-const int NUMBER_OF_TEXTURES = 1;
-const GLint LEVEL_OF_DETAIL  = 0;
-const GLint TEXTURE_BORDER   = 0;
-const int FONTBANK_SIZE = 16;
+           JUMP_SFX_FILEPATH[]    = "bounce.wav",
+           LEVEL_1_FILEPATH[]     = "level_1.txt";
+
+// The game loads the copies of its shaders and levels that were bundled next to it, and nobody
+// edits those. Debug builds in Xcode define HOT_RELOAD_SOURCE_ROOT as the project folder
+// ($(SRCROOT)), so hot reload watches the files in the source tree instead. Without it we watch
+// the ones in the working directory, which is right when running from the project folder
+#ifdef HOT_RELOAD_SOURCE_ROOT
+const char SHADER_SOURCE_DIRECTORY[] = HOT_RELOAD_SOURCE_ROOT "/SDLProject/",
+           LEVEL_SOURCE_DIRECTORY[]  = HOT_RELOAD_SOURCE_ROOT "/";
+#else
+const char SHADER_SOURCE_DIRECTORY[] = "",
+           LEVEL_SOURCE_DIRECTORY[]  = "";
+#endif
 
 unsigned int LEVEL_1_DATA[] =
 {
@@ -86,10 +120,56 @@ bool lostGame = false;
 bool winGame = false;
 
 ShaderProgram m_program;
+ShaderProgram m_instanced_program;
+SpriteBatch m_sprite_batch;
+InstancedSpriteRenderer m_instanced_renderer;
+RenderQueue m_render_queue;
+StreamBuffer m_stream_buffer;
+TextureAtlas m_texture_atlas;
+FileWatcher m_file_watcher;
+std::string m_v_shader_source_path, m_f_shader_source_path, m_v_instanced_shader_source_path, m_level_1_source_path;
+HeadlessTarget m_headless;
+FramePacer m_frame_pacer;
+SweepAndPrune m_sweep_and_prune;
+std::vector<CollisionPair> m_collision_pairs;
 glm::mat4 m_view_matrix, m_projection_matrix;
 
-float m_previous_ticks = 0.0f,
-      m_accumulator    = 0.0f;
+double m_previous_ticks = 0.0;
+float  m_accumulator    = 0.0f;
+
+// ————— THREADED SIMULATION ————— //
+// With --threaded-simulation, the fixed steps run on a thread of their own and render() draws
+// whatever they published last, so a frame costs the longer of the two instead of both added up
+struct WorldSnapshot
+{
+    EntitySnapshot player;
+    EntitySnapshot enemies[ENEMY_COUNT];
+    bool   lost_game;
+    double time;  // When the simulation reached these positions, on the frame pacer's clock
+};
+
+bool m_is_threaded = false;
+SDL_Thread *m_simulation_thread = NULL;
+std::atomic<bool> m_simulation_is_running(false);
+TripleBuffer<WorldSnapshot> m_snapshots;
+
+// Stand-ins that the snapshots are copied into for drawing; the real entities belong to the simulation thread
+EntityStore m_render_entities;
+Entity *m_render_player = NULL;
+Entity *m_render_enemies[ENEMY_COUNT];
+
+// Input on its way to the simulation thread. The latest movement is all that matters, but jumps
+// are counted, so a quick tap that comes and goes between two steps still gets through
+std::atomic<int> m_input_movement(0);
+std::atomic<int> m_input_jumps(0);
+
+// And on the way back: jumps the simulation has started, which the main thread plays the sound
+// for, since SDL_mixer isn't meant to be called from the simulation thread
+std::atomic<int> m_jumps_started(0);
+int m_jump_sounds_played = 0;
+
+void start_simulation();
+void stop_simulation();
 
 std::string loseText = "You Lose";
 std::string winText = "You win";
@@ -110,96 +190,93 @@ bool isOffScreen(Entity* entity) {
 
     return false;
 }
-GLuint load_texture(const char* filepath)
+
+
+// Reads a level written out the same way as LEVEL_1_DATA (commas optional). Anything that isn't
+// exactly width * height tiles is turned down, and level_data is left as it was
+bool load_level(const char *filepath, unsigned int *level_data, int width, int height)
 {
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+    std::ifstream file(filepath);
+    if (file.fail()) return false;
     
-    if (image == NULL)
-    {
-        LOG("Unable to load image. Make sure the path is correct.");
-        assert(false);
-    }
-    
-    GLuint texture_id;
-    glGenTextures(NUMBER_OF_TEXTURES, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    std::stringstream contents;
+    contents << file.rdbuf();
+    std::string text = contents.str();
+    for (int i = 0; i < text.size(); i++) if (text[i] == ',') text[i] = ' ';
     
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    std::vector<unsigned int> tiles;
+    std::istringstream stream(text);
+    unsigned int tile;
+    while (stream >> tile) tiles.push_back(tile);
     
-    stbi_image_free(image);
+    if (!stream.eof() || tiles.size() != width * height)
+    {
+        LOG("Level " << filepath << " should be " << width << " x " << height << " tiles; ignoring it");
+        return false;
+    }
     
-    return texture_id;
+    std::copy(tiles.begin(), tiles.end(), level_data);
+    return true;
 }
 
-
-void DrawText(ShaderProgram *program, GLuint font_texture_id, std::string text, float screen_size, float spacing, glm::vec3 position)
+// Builds the new program next to the old one, so a shader that doesn't compile
+// leaves the game running with whatever it had before
+bool reload_program(ShaderProgram *program, const char *vertex_shader_path, const char *fragment_shader_path)
 {
-    // Scale the size of the fontbank in the UV-plane
-    // We will use this for spacing and positioning
-    float width = 1.0f / FONTBANK_SIZE;
-    float height = 1.0f / FONTBANK_SIZE;
-
-    // Instead of having a single pair of arrays, we'll have a series of pairs—one for each character
-    // Don't forget to include <vector>!
-    std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
-
-    // For every character...
-    for (int i = 0; i < text.size(); i++) {
-        // 1. Get their index in the spritesheet, as well as their offset (i.e. their position
-        //    relative to the whole sentence)
-        int spritesheet_index = (int) text[i];  // ascii value of character
-        float offset = (screen_size + spacing) * i;
-        
-        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
-        float u_coordinate = (float) (spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
-        float v_coordinate = (float) (spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
-
-        // 3. Inset the current pair in both vectors
-        vertices.insert(vertices.end(), {
-            offset + (-0.5f * screen_size), 0.5f * screen_size,
-            offset + (-0.5f * screen_size), -0.5f * screen_size,
-            offset + (0.5f * screen_size), 0.5f * screen_size,
-            offset + (0.5f * screen_size), -0.5f * screen_size,
-            offset + (0.5f * screen_size), 0.5f * screen_size,
-            offset + (-0.5f * screen_size), -0.5f * screen_size,
-        });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
-        });
+    ShaderProgram new_program;
+    if (!new_program.Load(vertex_shader_path, fragment_shader_path))
+    {
+        LOG("Keeping the old " << vertex_shader_path << " / " << fragment_shader_path << " program");
+        new_program.Cleanup();
+        return false;
     }
-
-    // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
-    
-    program->SetModelMatrix(model_matrix);
-    glUseProgram(program->programID);
     
-    glVertexAttribPointer(program->positionAttribute, 2, GL_FLOAT, false, 0, vertices.data());
-    glEnableVertexAttribArray(program->positionAttribute);
-    glVertexAttribPointer(program->texCoordAttribute, 2, GL_FLOAT, false, 0, texture_coordinates.data());
-    glEnableVertexAttribArray(program->texCoordAttribute);
+    new_program.SetProjectionMatrix(m_projection_matrix);
+    new_program.SetViewMatrix(m_view_matrix);
     
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int) (text.size() * 6));
-    
-    glDisableVertexAttribArray(program->positionAttribute);
-    glDisableVertexAttribArray(program->texCoordAttribute);
+    program->Cleanup();
+    *program = new_program;
+    return true;
 }
 
-
+// Runs between frames, so nothing is ever drawn with half a swap
+void hot_reload()
+{
+    const std::vector<std::string> &changed_files = m_file_watcher.poll();
+    
+    for (int i = 0; i < changed_files.size(); i++)
+    {
+        const std::string &path = changed_files[i];
+        
+        if (path == m_v_shader_source_path || path == m_f_shader_source_path)
+        {
+            reload_program(&m_program, m_v_shader_source_path.c_str(), m_f_shader_source_path.c_str());
+        }
+        
+        if (path == m_v_instanced_shader_source_path || path == m_f_shader_source_path)
+        {
+            // The instanced renderer holds on to the program's locations, so it has to start over too
+            if (reload_program(&m_instanced_program, m_v_instanced_shader_source_path.c_str(), m_f_shader_source_path.c_str()))
+            {
+                m_instanced_renderer.cleanup();
+                m_instanced_renderer.initialise(&m_instanced_program, &m_stream_buffer);
+            }
+        }
+        
+        if (path == m_level_1_source_path)
+        {
+            // The map reads straight out of LEVEL_1_DATA, so load into a copy and let it work out what changed
+            unsigned int level_data[LEVEL1_WIDTH * LEVEL1_HEIGHT];
+            if (load_level(m_level_1_source_path.c_str(), level_data, LEVEL1_WIDTH, LEVEL1_HEIGHT))
+            {
+                // The simulation collides against the level, so it sits this out
+                if (m_is_threaded) stop_simulation();
+                LOG("Reloaded " << m_level_1_source_path << ", rebuilt " << g_state.map->set_tiles(level_data) << " chunk(s)");
+                if (m_is_threaded) start_simulation();
+            }
+        }
+    }
+}
 
 void initialise()
 {
@@ -208,7 +285,7 @@ void initialise()
     m_display_window = SDL_CreateWindow(GAME_WINDOW_NAME,
                                       SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                       WINDOW_WIDTH, WINDOW_HEIGHT,
-                                      SDL_WINDOW_OPENGL);
+                                      SDL_WINDOW_OPENGL | m_headless.get_window_flags());
     
     SDL_GLContext context = SDL_GL_CreateContext(m_display_window);
     SDL_GL_MakeCurrent(m_display_window, context);
@@ -219,6 +296,15 @@ void initialise()
     
     // ————— VIDEO SETUP ————— //
     glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    m_headless.initialise(WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    // Linked shaders are saved between launches, so only the first start has to compile them
+    char *pref_path = SDL_GetPrefPath("CS3113", "Project 4");
+    if (pref_path != NULL)
+    {
+        ShaderProgram::cacheDirectory = pref_path;
+        SDL_free(pref_path);
+    }
     
     m_program.Load(V_SHADER_PATH, F_SHADER_PATH);
     
@@ -228,23 +314,50 @@ void initialise()
     m_program.SetProjectionMatrix(m_projection_matrix);
     m_program.SetViewMatrix(m_view_matrix);
     
-    glUseProgram(m_program.programID);
+    // Every frame's sprite quads and instances stream through here; a region has to fit the biggest sprite batch flush
+    m_stream_buffer.initialise(QuadIndexBuffer::MAX_QUADS * VERTICES_PER_QUAD * sizeof(SpriteVertex));
+    
+    // Enemies are drawn with hardware instancing when the context supports it
+    m_instanced_program.Load(V_INSTANCED_SHADER_PATH, F_SHADER_PATH);
+    m_instanced_program.SetProjectionMatrix(m_projection_matrix);
+    m_instanced_program.SetViewMatrix(m_view_matrix);
+    m_instanced_renderer.initialise(&m_instanced_program, &m_stream_buffer);
+    
+    m_program.Use();
     
     glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
     
+    // ————— TEXTURE ATLAS ————— //
+    // Everything we draw lives in one texture, so the whole frame needs a single texture bind
+    m_texture_atlas.add(MAP_TILESET_FILEPATH);
+    m_texture_atlas.add(SPRITESHEET_FILEPATH);
+    m_texture_atlas.add(ENEMY_FILEPATH);
+    m_texture_atlas.add(FONT_FILEPATH);
+    GLuint atlas_texture_id = m_texture_atlas.build();
+    
+    g_state.font_texture_id     = atlas_texture_id;
+    g_state.font_texture_region = m_texture_atlas.get_region(FONT_FILEPATH);
+    
+    // The text is only built once here; after that it's just a draw call every frame
+    g_state.lose_text = new TextMesh(g_state.font_texture_id, g_state.font_texture_region, 0.5f, 0.05f, glm::vec3(-1.0f, 0.0f, 0.0f));
+    g_state.lose_text->set_text(loseText);
+    
     // ————— MAP SET-UP ————— //
-    GLuint map_texture_id = load_texture(MAP_TILESET_FILEPATH);
-    g_state.map = new Map(LEVEL1_WIDTH, LEVEL1_HEIGHT, LEVEL_1_DATA, map_texture_id, 1.0f, 4, 1);
+    // The level file wins if it's there; otherwise we play the one built in above
+    load_level(LEVEL_1_FILEPATH, LEVEL_1_DATA, LEVEL1_WIDTH, LEVEL1_HEIGHT);
+    g_state.map = new Map(LEVEL1_WIDTH, LEVEL1_HEIGHT, LEVEL_1_DATA, atlas_texture_id, 1.0f, 4, 1,
+                          m_texture_atlas.get_region(MAP_TILESET_FILEPATH));
     
     // ————— GEORGE SET-UP ————— //
     // Existing
-    g_state.player = new Entity();
+    g_state.player = new Entity(&g_state.entities);
     g_state.player->set_entity_type(PLAYER);
     g_state.player->set_position(glm::vec3(0.0f, 0.0f, 0.0f));
     g_state.player->set_movement(glm::vec3(0.0f));
     g_state.player->set_speed(2.5f);
     g_state.player->set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
-    g_state.player->m_texture_id = load_texture(SPRITESHEET_FILEPATH);
+    g_state.player->m_texture_id     = atlas_texture_id;
+    g_state.player->m_texture_region = m_texture_atlas.get_region(SPRITESHEET_FILEPATH);
     
     // Walking
     g_state.player->m_walking[g_state.player->LEFT]  = new int[4] { 1, 5, 9,  13 };
@@ -253,9 +366,9 @@ void initialise()
     g_state.player->m_walking[g_state.player->DOWN]  = new int[4] { 0, 4, 8,  12 };
 
     g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->RIGHT];  // start George looking left
-    g_state.player->m_animation_frames = 4;
-    g_state.player->m_animation_index  = 0;
-    g_state.player->m_animation_time   = 0.0f;
+    g_state.player->set_animation_frames(4);
+    g_state.player->set_animation_index(0);
+    g_state.player->set_animation_time(0.0f);
     g_state.player->m_animation_cols   = 4;
     g_state.player->m_animation_rows   = 4;
     g_state.player->set_height(0.8f);
@@ -265,15 +378,16 @@ void initialise()
     g_state.player->m_jumping_power = 5.0f;
     
     // ––––– SOPHIE ––––– //
-    GLuint enemy_texture_id = load_texture(ENEMY_FILEPATH);
+    AtlasRegion enemy_texture_region = m_texture_atlas.get_region(ENEMY_FILEPATH);
     
     
     for (int i = 0; i < ENEMY_COUNT; i++){
-        g_state.enemies[i] = new Entity();
+        g_state.enemies[i] = new Entity(&g_state.entities);
         g_state.enemies[i]->set_entity_type(ENEMY);
         g_state.enemies[i]->set_ai_state(IDLE);
         g_state.enemies[i]->set_position(glm::vec3(i+1, 0.0f, 0.0f));
-        g_state.enemies[i]->m_texture_id = enemy_texture_id;
+        g_state.enemies[i]->m_texture_id     = atlas_texture_id;
+        g_state.enemies[i]->m_texture_region = enemy_texture_region;
         g_state.enemies[i]->set_movement(glm::vec3(0.0f));
         g_state.enemies[i]->set_speed(1);
         g_state.enemies[i]->set_acceleration(glm::vec3(0.0f, -9.81f, 0.0f));
@@ -293,14 +407,70 @@ void initialise()
     g_state.jump_sfx = Mix_LoadWAV(JUMP_SFX_FILEPATH);
     
     // ————— BLENDING ————— //
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    // Start the state tracker from scratch, so the first draw sets everything explicitly
+    RenderState::invalidate();
+    RenderState::set_blend(true, GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    
+    // ————— HOT RELOAD ————— //
+    // Saving any of these while the game runs swaps them in without a restart (see hot_reload)
+    m_v_shader_source_path           = std::string(SHADER_SOURCE_DIRECTORY) + V_SHADER_PATH;
+    m_f_shader_source_path           = std::string(SHADER_SOURCE_DIRECTORY) + F_SHADER_PATH;
+    m_v_instanced_shader_source_path = std::string(SHADER_SOURCE_DIRECTORY) + V_INSTANCED_SHADER_PATH;
+    m_level_1_source_path            = std::string(LEVEL_SOURCE_DIRECTORY)  + LEVEL_1_FILEPATH;
+    
+    m_file_watcher.watch(m_v_shader_source_path.c_str());
+    m_file_watcher.watch(m_f_shader_source_path.c_str());
+    m_file_watcher.watch(m_v_instanced_shader_source_path.c_str());
+    m_file_watcher.watch(m_level_1_source_path.c_str());
+    
+    // ————— FRAME PACING ————— //
+    // Started last, so loading doesn't count against the first frame. Headless runs go flat out
+    if (m_headless.is_enabled()) m_frame_pacer.initialise(0.0, false);
+    else                         m_frame_pacer.initialise(TARGET_FRAME_RATE, USE_VSYNC);
+    
+    // ————— THREADED SIMULATION ————— //
+    if (m_is_threaded)
+    {
+        m_render_player = new Entity(&m_render_entities);
+        for (int i = 0; i < ENEMY_COUNT; i++) m_render_enemies[i] = new Entity(&m_render_entities);
+        
+        start_simulation();
+    }
 }
 
-void process_input()
+// Takes effect on the player straight away, so it belongs to whichever thread is simulating.
+// Returns whether the player started a jump, for whoever plays the sound
+bool apply_input(int movement_x, bool is_jump_pressed)
 {
     g_state.player->set_movement(glm::vec3(0.0f));
     
+    bool has_jumped = is_jump_pressed && g_state.player->m_collided_bottom;
+    if (has_jumped) g_state.player->m_is_jumping = true;
+    
+    if (movement_x < 0)
+    {
+        g_state.player->set_movement(glm::vec3(-1.0f, 0.0f, 0.0f));
+        g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->LEFT];
+    }
+    else if (movement_x > 0)
+    {
+        g_state.player->set_movement(glm::vec3(1.0f, 0.0f, 0.0f));
+        g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->RIGHT];
+    }
+    
+    // This makes sure that the player can't move faster diagonally
+    if (glm::length(g_state.player->get_movement()) > 1.0f)
+    {
+        g_state.player->set_movement(glm::normalize(g_state.player->get_movement()));
+    }
+    
+    return has_jumped;
+}
+
+void process_input()
+{
+    bool is_jump_pressed = false;
+    
     SDL_Event event;
     while (SDL_PollEvent(&event))
     {
@@ -319,11 +489,7 @@ void process_input()
                         
                     case SDLK_SPACE:
                         // Jump
-                        if (g_state.player->m_collided_bottom)
-                        {
-                            g_state.player->m_is_jumping = true;
-                            Mix_PlayChannel(-1, g_state.jump_sfx, 0);
-                        }
+                        is_jump_pressed = true;
                         break;
                         
                     default:
@@ -336,29 +502,59 @@ void process_input()
     }
     
     const Uint8 *key_state = SDL_GetKeyboardState(NULL);
-
-    if (key_state[SDL_SCANCODE_LEFT])
+    
+    int movement_x = 0;
+    if      (key_state[SDL_SCANCODE_LEFT])  movement_x = -1;
+    else if (key_state[SDL_SCANCODE_RIGHT]) movement_x =  1;
+    
+    if (m_is_threaded)
     {
-        g_state.player->m_movement.x = -1.0f;
-        g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->LEFT];
+        // Events have to be read on this thread; the simulation picks them up at its next step,
+        // so input is never more than a step late
+        m_input_movement.store(movement_x);
+        if (is_jump_pressed) m_input_jumps++;
+        
+        // Catch up on the jumps the simulation has started since we last looked
+        int jumps_started = m_jumps_started.load();
+        if (jumps_started != m_jump_sounds_played) Mix_PlayChannel(-1, g_state.jump_sfx, 0);
+        m_jump_sounds_played = jumps_started;
     }
-    else if (key_state[SDL_SCANCODE_RIGHT])
-    {
-        g_state.player->m_movement.x = 1.0f;
-        g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->RIGHT];
+    else if (apply_input(movement_x, is_jump_pressed)) Mix_PlayChannel(-1, g_state.jump_sfx, 0);
+}
+
+// One fixed step of the whole game
+void step_simulation()
+{
+    g_state.player->update(FIXED_TIMESTEP, g_state.player, NULL, 0, g_state.map);
+    for (int i = 0; i < ENEMY_COUNT; i++){
+        g_state.enemies[i]->update(FIXED_TIMESTEP, g_state.player, NULL, 0, g_state.map);
     }
     
-    // This makes sure that the player can't move faster diagonally
-    if (glm::length(g_state.player->m_movement) > 1.0f)
-    {
-        g_state.player->m_movement = glm::normalize(g_state.player->m_movement);
+    // The level is a long, low strip, so sorting everyone along x leaves very few pairs to check
+    m_sweep_and_prune.update(&g_state.entities);
+    m_sweep_and_prune.find_pairs(m_collision_pairs);
+    
+    for (size_t i = 0; i < m_collision_pairs.size(); i++){
+        Entity *first  = g_state.entities.owner[m_collision_pairs[i].a],
+               *second = g_state.entities.owner[m_collision_pairs[i].b];
+        
+        if (first != g_state.player && second != g_state.player) continue;
+        if (first->check_collision(second)) {
+            lostGame = true;
+        }
+    }
+    
+    for (int i = 0; i < ENEMY_COUNT; i++){
+        if (isOffScreen(g_state.enemies[i])){
+            g_state.enemies[i]->deactivate();
+        }
     }
 }
 
 void update()
 {
-    float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
-    float delta_time = ticks - m_previous_ticks;
+    double ticks = m_headless.is_enabled() ? m_headless.get_ticks() / MILLISECONDS_IN_SECOND : m_frame_pacer.get_time();
+    float delta_time = (float) (ticks - m_previous_ticks);
     m_previous_ticks = ticks;
     
     delta_time += m_accumulator;
@@ -371,70 +567,198 @@ void update()
     
     while (delta_time >= FIXED_TIMESTEP)
     {
-        g_state.player->update(FIXED_TIMESTEP, g_state.player, NULL, 0, g_state.map);
-        for (int i = 0; i < ENEMY_COUNT; i++){
-            g_state.enemies[i]->update(FIXED_TIMESTEP, g_state.player, NULL, 0, g_state.map);
-            if (g_state.player->check_collision(g_state.enemies[i])) {
-                lostGame = true;
-            }
-            if (isOffScreen(g_state.enemies[i])){
-                g_state.enemies[i]->deactivate();
-            }
-        }
-        
-
+        step_simulation();
         delta_time -= FIXED_TIMESTEP;
     }
     
     m_accumulator = delta_time;
+}
+
+void publish_snapshot(double time)
+{
+    WorldSnapshot &snapshot = m_snapshots.get_back();
     
-    m_view_matrix = glm::mat4(1.0f);
-    m_view_matrix = glm::translate(m_view_matrix, glm::vec3(-g_state.player->get_position().x, 0.0f, 0.0f));
+    snapshot.player = g_state.player->get_snapshot();
+    for (int i = 0; i < ENEMY_COUNT; i++) snapshot.enemies[i] = g_state.enemies[i]->get_snapshot();
+    snapshot.lost_game = lostGame;
+    snapshot.time      = time;
+    
+    m_snapshots.publish();
+}
+
+int simulate(void *data)
+{
+    int    jumps_taken   = m_input_jumps.load();
+    double previous_time = m_frame_pacer.get_time();
+    double accumulator   = 0.0;
+    
+    while (m_simulation_is_running.load())
+    {
+        double time = m_frame_pacer.get_time();
+        accumulator  += time - previous_time;
+        previous_time = time;
+        
+        bool has_stepped = false;
+        while (accumulator >= FIXED_TIMESTEP)
+        {
+            int jumps = m_input_jumps.load();
+            if (apply_input(m_input_movement.load(), jumps != jumps_taken)) m_jumps_started++;
+            jumps_taken = jumps;
+            
+            step_simulation();
+            accumulator -= FIXED_TIMESTEP;
+            has_stepped  = true;
+        }
+        
+        if (has_stepped) publish_snapshot(time - accumulator);
+        
+        // Nothing to do until the next step is due, so give the core back until then
+        SDL_Delay((Uint32) ((FIXED_TIMESTEP - accumulator) * MILLISECONDS_IN_SECOND));
+    }
+    
+    return 0;
+}
+
+void start_simulation()
+{
+    // Give render() something to draw before the first step comes in
+    publish_snapshot(m_frame_pacer.get_time());
+    
+    m_simulation_is_running = true;
+    m_simulation_thread = SDL_CreateThread(simulate, "simulation", NULL);
+    
+    if (m_simulation_thread == NULL)
+    {
+        LOG("Couldn't start the simulation thread (" << SDL_GetError() << "); simulating on this one instead");
+        m_simulation_is_running = false;
+        m_is_threaded = false;
+    }
+}
+
+void stop_simulation()
+{
+    if (m_simulation_thread == NULL) return;
+    
+    m_simulation_is_running = false;
+    SDL_WaitThread(m_simulation_thread, NULL);
+    m_simulation_thread = NULL;
 }
 
 void render()
 {
+    ShaderProgram::ResetCallCounters();
+    RenderState::reset_counters();
+    
+    // How far we are into the next fixed step; everything that moves is drawn that far between its last two positions
+    float alpha = m_accumulator / FIXED_TIMESTEP;
+    
+    Entity  *player    = g_state.player;
+    Entity **enemies   = g_state.enemies;
+    bool     lost_game = false;
+    
+    // lostGame belongs to the simulation thread while it runs, so we only go by the snapshot then
+    if (!m_is_threaded) lost_game = lostGame;
+    else
+    {
+        m_snapshots.update();
+        const WorldSnapshot &snapshot = m_snapshots.get_front();
+        
+        m_render_player->apply_snapshot(snapshot.player);
+        for (int i = 0; i < ENEMY_COUNT; i++) m_render_enemies[i]->apply_snapshot(snapshot.enemies[i]);
+        
+        player    = m_render_player;
+        enemies   = m_render_enemies;
+        lost_game = snapshot.lost_game;
+        
+        // There's no accumulator on this side, so the clock tells us how far into the step we are
+        alpha = glm::clamp((float) ((m_frame_pacer.get_time() - snapshot.time) / FIXED_TIMESTEP), 0.0f, 1.0f);
+    }
+    
+    player->interpolate(alpha);
+    for (int i = 0; i < ENEMY_COUNT; i++) enemies[i]->interpolate(alpha);
+    
+    // The camera follows the interpolated player too, or the world would judder around it instead
+    m_view_matrix = glm::mat4(1.0f);
+    m_view_matrix = glm::translate(m_view_matrix, glm::vec3(-player->get_interpolated_position(alpha).x, 0.0f, 0.0f));
+    
     m_program.SetViewMatrix(m_view_matrix);
+    m_instanced_program.SetViewMatrix(m_view_matrix);
     
     glClear(GL_COLOR_BUFFER_BIT);
     
-    g_state.player->render(&m_program);
-    g_state.map->render(&m_program);
-    for (int i = 0; i < ENEMY_COUNT; i++)    g_state.enemies[i]->render(&m_program);
+    m_sprite_batch.begin(&m_program, &m_stream_buffer);
+    m_instanced_renderer.begin();
     
-    if (lostGame) {
-        GLuint fontTextureID = load_texture("font1.png");
-
-        glm::vec3 textPosition = glm::vec3(-1.0f, 0.0f, 0.0f);
-        DrawText(&m_program, fontTextureID, loseText, 0.5f, 0.05f, textPosition);
+    // Nothing is drawn yet; the queue sorts everything by layer, then shader and texture, first
+    m_render_queue.begin(&m_sprite_batch, &m_instanced_renderer, m_view_matrix, m_projection_matrix);
+    
+    m_render_queue.push_map(g_state.map, &m_program, MAP_LAYER);
+    m_render_queue.push_sprite(player, ENTITY_LAYER);
+    
+    for (int i = 0; i < ENEMY_COUNT; i++)
+    {
+        if (m_instanced_renderer.is_supported()) m_render_queue.push_instanced_sprite(enemies[i], ENTITY_LAYER);
+        else                                     m_render_queue.push_sprite(enemies[i], ENTITY_LAYER);
     }
     
+    if (lost_game) m_render_queue.push_text(g_state.lose_text, &m_program, TEXT_LAYER);
+    
+    m_render_queue.submit();
+    
+    m_instanced_renderer.end();
+    m_sprite_batch.end();
+    
+    m_stream_buffer.end_frame();
+    
     SDL_GL_SwapWindow(m_display_window);
 }
 
 void shutdown()
 {
-    SDL_Quit();
+    stop_simulation();
+    
+    delete m_render_player;
+    for (int i = 0; i < ENEMY_COUNT; i++) delete m_render_enemies[i];
     
     for (int i = 0; i < ENEMY_COUNT; i++){
         delete g_state.enemies[i];
     }
     delete    g_state.player;
-    delete    g_state.map;
+    delete    g_state.map;  // Frees GL buffers, so this has to happen while the context is still alive
+    delete    g_state.lose_text;
+    QuadIndexBuffer::cleanup();
+    m_instanced_renderer.cleanup();
+    m_stream_buffer.cleanup();
+    m_file_watcher.cleanup();
+    m_headless.cleanup();
+    m_frame_pacer.report();
     Mix_FreeChunk(g_state.jump_sfx);
     Mix_FreeMusic(g_state.bgm);
+    
+    SDL_Quit();
 }
 
 // ————— GAME LOOP ————— //
 int main(int argc, char* argv[])
 {
+    m_headless.parse_arguments(argc, argv);
+    for (int i = 1; i < argc; i++) if (strcmp(argv[i], "--threaded-simulation") == 0) m_is_threaded = true;
+    
     initialise();
     
     while (m_game_is_running)
     {
         process_input();
-        update();
+        if (!m_is_threaded) update();
         render();
+        hot_reload();
+        
+        // Headless runs stop by themselves once they've drawn the frames they were asked for
+        m_headless.end_frame();
+        if (m_headless.is_finished()) m_game_is_running = false;
+        
+        // Rather than spinning straight into a frame identical to this one, wait until the next one is due
+        m_frame_pacer.end_frame();
     }
     
     shutdown();
@@ -0,0 +1,28 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+
+// One of each per sprite rather than per vertex
+attribute vec2 instanceTranslation;
+attribute vec2 instanceScale;
+attribute float instanceFrame;
+
+// No model matrix here, so this is just projectionMatrix * viewMatrix (see ShaderProgram)
+uniform mat4 modelViewProjectionMatrix;
+
+// Columns and rows of the sprite sheet
+uniform vec2 atlasSize;
+
+// Where the sprite sheet sits in the texture: u, v, width, height
+uniform vec4 atlasRegion;
+
+varying vec2 texCoordVar;
+
+void main()
+{
+    // Same math as Entity::draw_sprite_from_texture_atlas, done per vertex instead
+    float row    = floor((instanceFrame + 0.5) / atlasSize.x);
+    float column = instanceFrame - row * atlasSize.x;
+    texCoordVar  = atlasRegion.xy + (vec2(column, row) + texCoord) / atlasSize * atlasRegion.zw;
+    
+	gl_Position = modelViewProjectionMatrix * vec4(position.xy * instanceScale + instanceTranslation, 0.0, 1.0);
+}
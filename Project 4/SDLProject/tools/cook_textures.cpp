@@ -0,0 +1,73 @@
+/**
+* Texture cooker
+*
+* Decodes images once, offline, and writes them out as cooked textures (see CookedTexture.h):
+* raw RGBA with the whole mip chain already built. At start-up, TextureAtlas picks a cooked copy
+* up instead of the image whenever there's an up-to-date one next to it. The atlas only ever
+* reads the full-size level, so Project 4's images are cooked without the rest.
+*
+* The .ctex files are build output and aren't checked in. The Xcode target's "Cook Textures"
+* phase builds this tool and runs it on the images CopyFiles has just put next to the game.
+* Without Xcode, cook them by hand next to the images:
+*
+*   cd "Project 4/SDLProject"
+*   g++ -O2 -std=c++14 -I. -I../../Common tools/cook_textures.cpp ../../Common/CookedTexture.cpp \
+*       $(sdl2-config --cflags) -o cook_textures
+*   cd .. && SDLProject/cook_textures --no-mipmaps tileset.png george_0.png soph.png font1.png
+*
+* A hand-cooked copy goes stale when its image is edited. The game then sees the image no longer
+* matches the size and hash its copy was made from, and loads the image instead.
+*
+* Block compression (BCn/ETC2) was left out on purpose: these are small pixel-art sprites drawn
+* with nearest filtering, where its artifacts would show, and the GL 2.1 context on macOS has no
+* ETC2 at all
+**/
+
+#define STB_IMAGE_IMPLEMENTATION
+#define LOG(argument) std::cout << argument << '\n'
+
+#include <iostream>
+#include <string>
+#include "stb_image.h"
+#include "CookedTexture.h"
+
+int main(int argc, char* argv[])
+{
+    bool mipmaps = !(argc > 1 && std::string(argv[1]) == "--no-mipmaps");
+    int first_image = mipmaps ? 1 : 2;
+    
+    if (argc <= first_image)
+    {
+        LOG("Usage: cook_textures [--no-mipmaps] image.png [image.png ...]");
+        return 1;
+    }
+    
+    int failures = 0;
+    
+    for (int i = first_image; i < argc; i++)
+    {
+        int width, height;
+        unsigned char *pixels = stbi_load(argv[i], &width, &height, NULL, STBI_rgb_alpha);
+        
+        if (pixels == NULL)
+        {
+            LOG("Unable to load " << argv[i] << ": " << stbi_failure_reason());
+            failures++;
+            continue;
+        }
+        
+        if (CookedTexture::cook(argv[i], pixels, width, height, mipmaps))
+        {
+            LOG(argv[i] << " -> " << CookedTexture::get_cooked_path(argv[i]) << " (" << width << "x" << height << ")");
+        }
+        else
+        {
+            LOG("Unable to write " << CookedTexture::get_cooked_path(argv[i]));
+            failures++;
+        }
+        
+        stbi_image_free(pixels);
+    }
+    
+    return failures == 0 ? 0 : 1;
+}
@@ -1,44 +1,198 @@
 #define GL_SILENCE_DEPRECATION
 
 #include "ShaderProgram.h"
+#include <SDL.h>
+#include <stdint.h>
 
-void ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile) {
+// Program binaries came in with GL 4.1; older contexts (like the macOS legacy one) may still
+// have the ARB extension. Neither is in every header, so the entry points are looked up at runtime
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (*GetProgramBinaryFunction)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (*ProgramBinaryFunction)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (*ProgramParameteriFunction)(GLuint program, GLenum pname, GLint value);
+
+static GetProgramBinaryFunction  getProgramBinary  = NULL;
+static ProgramBinaryFunction     programBinary     = NULL;
+static ProgramParameteriFunction programParameteri = NULL;
+
+// Written at the front of every cache file, so we never feed GL something that isn't ours
+static const char CACHE_MAGIC[4] = { 'S', 'P', 'B', '1' };
+
+GLuint      ShaderProgram::currentProgram = 0;
+int         ShaderProgram::issuedCalls    = 0;
+int         ShaderProgram::skippedCalls   = 0;
+std::string ShaderProgram::cacheDirectory;
+
+bool ShaderProgram::Load(const char *vertexShaderFile, const char *fragmentShaderFile) {
+    
+    std::string vertexSource   = ReadShaderFile(vertexShaderFile);
+    std::string fragmentSource = ReadShaderFile(fragmentShaderFile);
+    
+    programID      = glCreateProgram();
+    vertexShader   = 0;
+    fragmentShader = 0;
+    
+    // A binary from an earlier launch skips compiling and linking altogether. The driver is
+    // free to turn it down (e.g. after an update), and then we just build from source
+    cachePath       = CachePath(vertexSource, fragmentSource);
+    loadedFromCache = !cachePath.empty() && LoadCachedBinary(cachePath);
     
-    // create the vertex shader
-    vertexShader = LoadShaderFromFile(vertexShaderFile, GL_VERTEX_SHADER);
-    // create the fragment shader
-    fragmentShader = LoadShaderFromFile(fragmentShaderFile, GL_FRAGMENT_SHADER);
+    if (!loadedFromCache) {
+        // create the vertex shader
+        vertexShader = LoadShaderFromString(vertexSource, GL_VERTEX_SHADER);
+        // create the fragment shader
+        fragmentShader = LoadShaderFromString(fragmentSource, GL_FRAGMENT_SHADER);
+        
+        // Create the final shader program from our vertex and fragment shaders
+        glAttachShader(programID, vertexShader);
+        glAttachShader(programID, fragmentShader);
+        if (!cachePath.empty()) programParameteri(programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glLinkProgram(programID);
+    }
     
-    // Create the final shader program from our vertex and fragment shaders
-    programID = glCreateProgram();
-    glAttachShader(programID, vertexShader);
-    glAttachShader(programID, fragmentShader);
-    glLinkProgram(programID);
+    // A freshly linked program has none of the uniforms we remember
+    hasModelMatrix = hasProjectionMatrix = hasViewMatrix = hasColor = false;
+    hasModelViewProjectionMatrix = false;
     
     GLint linkSuccess;
     glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
     if(linkSuccess == GL_FALSE) {
 	printf("Error linking shader program!\n");
+        // There's nothing to look up in a program that didn't link; GL would only raise errors
+        return false;
+    }
+    
+    if (!loadedFromCache && !cachePath.empty()) {
+        SaveCachedBinary(cachePath);
     }
     
     modelMatrixUniform = glGetUniformLocation(programID, "modelMatrix");
     projectionMatrixUniform = glGetUniformLocation(programID, "projectionMatrix");
     viewMatrixUniform = glGetUniformLocation(programID, "viewMatrix");
 	colorUniform = glGetUniformLocation(programID, "color");
+    modelViewProjectionMatrixUniform = glGetUniformLocation(programID, "modelViewProjectionMatrix");
+    usesCombinedMatrix = (GLint) modelViewProjectionMatrixUniform != -1;
+    
+    // Until someone sets them, the matrices are the identity, same as the shader would see
+    modelMatrix = viewMatrix = projectionMatrix = viewProjectionMatrix = glm::mat4(1.0f);
     
     positionAttribute = glGetAttribLocation(programID, "position");
     texCoordAttribute = glGetAttribLocation(programID, "texCoord");
 	
 	SetColor(1.0f, 1.0f, 1.0f, 1.0f);
     
+    return linkSuccess != GL_FALSE;
 }
 
 void ShaderProgram::Cleanup() {
+    if (currentProgram == programID) currentProgram = 0;
     glDeleteProgram(programID);
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
 }
 
+std::string ShaderProgram::ReadShaderFile(const std::string &shaderFile) {
+    std::ifstream infile(shaderFile);
+    
+    if(infile.fail()) {
+        std::cout << "Error opening shader file:" << shaderFile << std::endl;
+    }
+    
+    std::stringstream buffer;
+    buffer << infile.rdbuf();
+    return buffer.str();
+}
+
+std::string ShaderProgram::CachePath(const std::string &vertexSource, const std::string &fragmentSource) {
+    if (cacheDirectory.empty()) return "";
+    
+    if (getProgramBinary == NULL) {
+        if (!SDL_GL_ExtensionSupported("GL_ARB_get_program_binary")) return "";
+        
+        getProgramBinary  = (GetProgramBinaryFunction)  SDL_GL_GetProcAddress("glGetProgramBinary");
+        programBinary     = (ProgramBinaryFunction)     SDL_GL_GetProcAddress("glProgramBinary");
+        programParameteri = (ProgramParameteriFunction) SDL_GL_GetProcAddress("glProgramParameteri");
+        if (getProgramBinary == NULL || programBinary == NULL || programParameteri == NULL) {
+            getProgramBinary = NULL;
+            return "";
+        }
+    }
+    
+    // The extension can be there with no formats to offer (Mesa does this), which means no binaries
+    GLint formatCount = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if (formatCount == 0) return "";
+    
+    // A binary is only good for the exact same sources on the exact same driver, so all of
+    // them go into the name. 64-bit FNV-1a is plenty to tell a handful of programs apart
+    std::string key = vertexSource + '\0' + fragmentSource + '\0' +
+                      (const char *) glGetString(GL_VENDOR)   + '\0' +
+                      (const char *) glGetString(GL_RENDERER) + '\0' +
+                      (const char *) glGetString(GL_VERSION);
+    
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < key.size(); i++) {
+        hash ^= (unsigned char) key[i];
+        hash *= 1099511628211ull;
+    }
+    
+    char name[32];
+    snprintf(name, sizeof(name), "shader_%016llx.bin", (unsigned long long) hash);
+    return cacheDirectory + name;
+}
+
+bool ShaderProgram::LoadCachedBinary(const std::string &path) {
+    std::ifstream infile(path, std::ios::binary);
+    if (infile.fail()) return false;
+    
+    char magic[4];
+    GLenum format;
+    GLint length;
+    infile.read(magic, sizeof(magic));
+    infile.read((char *) &format, sizeof(format));
+    infile.read((char *) &length, sizeof(length));
+    if (infile.fail() || memcmp(magic, CACHE_MAGIC, sizeof(magic)) != 0 || length <= 0) return false;
+    
+    std::vector<char> binary(length);
+    infile.read(binary.data(), length);
+    if (infile.fail()) return false;
+    
+    programBinary(programID, format, binary.data(), length);
+    
+    GLint linkSuccess;
+    glGetProgramiv(programID, GL_LINK_STATUS, &linkSuccess);
+    return linkSuccess == GL_TRUE;
+}
+
+void ShaderProgram::SaveCachedBinary(const std::string &path) {
+    GLint length = 0;
+    glGetProgramiv(programID, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    
+    std::vector<char> binary(length);
+    GLenum format;
+    getProgramBinary(programID, length, &length, &format, binary.data());
+    
+    std::ofstream outfile(path, std::ios::binary);
+    if (outfile.fail()) {
+        std::cout << "Unable to write shader cache:" << path << std::endl;
+        return;
+    }
+    outfile.write(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    outfile.write((const char *) &format, sizeof(format));
+    outfile.write((const char *) &length, sizeof(length));
+    outfile.write(binary.data(), length);
+}
+
 GLuint ShaderProgram::LoadShaderFromFile(const std::string &shaderFile, GLenum type) {
     //Open a file stream with the file name
     std::ifstream infile(shaderFile);
@@ -84,22 +238,83 @@ GLuint ShaderProgram::LoadShaderFromString(const std::string &shaderContents, GL
     return shaderID;
 }
 
+void ShaderProgram::ResetCallCounters() {
+    issuedCalls  = 0;
+    skippedCalls = 0;
+}
+
+void ShaderProgram::Use() {
+    if (currentProgram == programID) {
+        skippedCalls++;
+        return;
+    }
+    glUseProgram(programID);
+    currentProgram = programID;
+    issuedCalls++;
+}
+
+void ShaderProgram::UploadMatrix(GLuint uniform, const glm::mat4 &matrix, glm::mat4 &shadow, bool &hasShadow) {
+    // Nothing to bind or upload if the program already holds this exact matrix
+    if (hasShadow && shadow == matrix) {
+        skippedCalls += 2;
+        return;
+    }
+    Use();
+    glUniformMatrix4fv(uniform, 1, GL_FALSE, &matrix[0][0]);
+    issuedCalls++;
+    shadow    = matrix;
+    hasShadow = true;
+}
+
 void ShaderProgram::SetColor(float r, float g, float b, float a) {
-	glUseProgram(programID);
+	glm::vec4 newColor(r, g, b, a);
+	if (hasColor && color == newColor) {
+		skippedCalls += 2;
+		return;
+	}
+	Use();
 	glUniform4f(colorUniform, r, g, b, a);
+	issuedCalls++;
+	color    = newColor;
+	hasColor = true;
+}
+
+bool ShaderProgram::UpdateShadow(const glm::mat4 &matrix, glm::mat4 &shadow, bool &hasShadow) {
+    if (hasShadow && shadow == matrix) {
+        skippedCalls += 2;
+        return false;
+    }
+    shadow    = matrix;
+    hasShadow = true;
+    return true;
 }
 
 void ShaderProgram::SetViewMatrix(const glm::mat4 &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(viewMatrixUniform, 1, GL_FALSE, &matrix[0][0]);
+    if (!usesCombinedMatrix) {
+        UploadMatrix(viewMatrixUniform, matrix, viewMatrix, hasViewMatrix);
+        return;
+    }
+    if (!UpdateShadow(matrix, viewMatrix, hasViewMatrix)) return;
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+    UploadMatrix(modelViewProjectionMatrixUniform, viewProjectionMatrix * modelMatrix, modelViewProjectionMatrix, hasModelViewProjectionMatrix);
 }
 
 void ShaderProgram::SetModelMatrix(const glm::mat4 &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(modelMatrixUniform, 1, GL_FALSE, &matrix[0][0]);
+    if (!usesCombinedMatrix) {
+        UploadMatrix(modelMatrixUniform, matrix, modelMatrix, hasModelMatrix);
+        return;
+    }
+    // The view-projection half is kept around, so a new model matrix costs one product
+    if (!UpdateShadow(matrix, modelMatrix, hasModelMatrix)) return;
+    UploadMatrix(modelViewProjectionMatrixUniform, viewProjectionMatrix * modelMatrix, modelViewProjectionMatrix, hasModelViewProjectionMatrix);
 }
 
 void ShaderProgram::SetProjectionMatrix(const glm::mat4 &matrix) {
-    glUseProgram(programID);
-    glUniformMatrix4fv(projectionMatrixUniform, 1, GL_FALSE, &matrix[0][0]);    
+    if (!usesCombinedMatrix) {
+        UploadMatrix(projectionMatrixUniform, matrix, projectionMatrix, hasProjectionMatrix);
+        return;
+    }
+    if (!UpdateShadow(matrix, projectionMatrix, hasProjectionMatrix)) return;
+    viewProjectionMatrix = projectionMatrix * viewMatrix;
+    UploadMatrix(modelViewProjectionMatrixUniform, viewProjectionMatrix * modelMatrix, modelViewProjectionMatrix, hasModelViewProjectionMatrix);
 }
@@ -6,15 +6,19 @@
 #define GL_GLEXT_PROTOTYPES 1
 #include <SDL_opengl.h>
 #include <string>
+#include <cstring>
+#include <vector>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
 
 class ShaderProgram {
     public:
 	
-		void Load(const char *vertexShaderFile, const char *fragmentShaderFile);
+		// Returns false if the program didn't link (the compile errors are printed as well)
+		bool Load(const char *vertexShaderFile, const char *fragmentShaderFile);
 		void Cleanup();
 
 		void SetModelMatrix(const glm::mat4 &matrix);
@@ -23,8 +27,17 @@ class ShaderProgram {
 	
 		void SetColor(float r, float g, float b, float a);
 	
+		// Binds the program, unless it is the one already bound
+		void Use();
+	
         GLuint LoadShaderFromString(const std::string &shaderContents, GLenum type);
         GLuint LoadShaderFromFile(const std::string &shaderFile, GLenum type);
+	
+		// Where linked program binaries get saved so later launches can skip compiling.
+		// Empty (the default) turns the cache off. Needs GL_ARB_get_program_binary
+		static std::string cacheDirectory;
+		std::string cachePath;  // Empty if the cache wasn't used
+		bool loadedFromCache;
     
         GLuint programID;
     
@@ -33,9 +46,43 @@ class ShaderProgram {
         GLuint viewMatrixUniform;
 		GLuint colorUniform;
 	
+		// Set when the vertex shader takes one premultiplied matrix (see shaders/*_mvp.glsl)
+		// instead of three. The products are then worked out here, once per change, rather
+		// than for every vertex
+		GLuint modelViewProjectionMatrixUniform;
+		bool usesCombinedMatrix;
+	
         GLuint positionAttribute;
         GLuint texCoordAttribute;
     
         GLuint vertexShader;
         GLuint fragmentShader;
+	
+		// GL calls made and avoided since the last ResetCallCounters(), across every program
+		static int issuedCalls;
+		static int skippedCalls;
+		static void ResetCallCounters();
+	
+    private:
+		// The program GL currently has bound, so Use() can tell when there is nothing to do
+		static GLuint currentProgram;
+	
+		// Uniforms keep their values inside the program, so we remember what we last sent and
+		// skip uploads that wouldn't change anything
+		glm::mat4 modelMatrix, projectionMatrix, viewMatrix;
+		glm::vec4 color;
+		bool hasModelMatrix = false, hasProjectionMatrix = false, hasViewMatrix = false, hasColor = false;
+	
+		// Only used with the combined matrix
+		glm::mat4 viewProjectionMatrix, modelViewProjectionMatrix;
+		bool hasModelViewProjectionMatrix = false;
+	
+		bool UpdateShadow(const glm::mat4 &matrix, glm::mat4 &shadow, bool &hasShadow);
+	
+		void UploadMatrix(GLuint uniform, const glm::mat4 &matrix, glm::mat4 &shadow, bool &hasShadow);
+	
+		std::string ReadShaderFile(const std::string &shaderFile);
+		std::string CachePath(const std::string &vertexSource, const std::string &fragmentSource);
+		bool LoadCachedBinary(const std::string &path);
+		void SaveCachedBinary(const std::string &path);
 };
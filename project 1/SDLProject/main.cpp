@@ -23,6 +23,8 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "ResourceCache.h"
+#include "HeadlessTarget.h"
 #include "stb_image.h"
 #include <iostream>
 using namespace std;
@@ -40,7 +42,7 @@ const int VIEWPORT_X      = 0,
           VIEWPORT_WIDTH  = WINDOW_WIDTH,
           VIEWPORT_HEIGHT = WINDOW_HEIGHT;
 
-const char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
+const char V_SHADER_PATH[] = "shaders/vertex_textured_mvp.glsl",
            F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
 
 const char PLAYER_SPRITE[] = "bear.png";
@@ -66,6 +68,8 @@ bool g_is_growing      = true;
 int g_frame_counter = 0;
 
 ShaderProgram g_program;
+ResourceCache g_resource_cache;
+HeadlessTarget g_headless;
 glm::mat4 g_view_matrix,
           g_model_matrix,
           g_model_matrix2,
@@ -92,31 +96,8 @@ void draw_object(glm::mat4 &object_model_matrix, GLuint &object_texture_id)
 
 GLuint load_texture(const char* filepath)
 {
-    // STEP 1: Loading the image file
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
-    
-    if (image == NULL)
-    {
-        LOG("Unable to load image. Make sure the path is correct.");
-        cout << filepath;
-        assert(false);
-    }
-    
-    // STEP 2: Generating and binding a texture ID to our image
-    GLuint textureID;
-    glGenTextures(NUMBER_OF_TEXTURES, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
-    
-    // STEP 3: Setting our texture filter parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    
-    // STEP 4: Releasing our file from memory and returning our texture id
-    stbi_image_free(image);
-    
-    return textureID;
+    // Decoding and uploading live in the cache, so asking for the same file twice costs nothing
+    return g_resource_cache.acquire_texture(filepath);
 }
 
 void initialise()
@@ -125,7 +106,7 @@ void initialise()
     g_display_window = SDL_CreateWindow("Hello, Delta Time!",
                                         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
                                         WINDOW_WIDTH, WINDOW_HEIGHT,
-                                        SDL_WINDOW_OPENGL);
+                                        SDL_WINDOW_OPENGL | g_headless.get_window_flags());
     
     SDL_GLContext context = SDL_GL_CreateContext(g_display_window);
     SDL_GL_MakeCurrent(g_display_window, context);
@@ -135,6 +116,15 @@ void initialise()
 #endif
     
     glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    g_headless.initialise(WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    // Linked shaders are saved between launches, so only the first start has to compile them
+    char *pref_path = SDL_GetPrefPath("CS3113", "Project 1");
+    if (pref_path != NULL)
+    {
+        ShaderProgram::cacheDirectory = pref_path;
+        SDL_free(pref_path);
+    }
     
     g_program.Load(V_SHADER_PATH, F_SHADER_PATH);
     g_view_matrix = glm::mat4(1.0f);  // Defines the position (location and orientation) of the camera
@@ -147,7 +137,7 @@ void initialise()
     
     g_program.SetColor(TRIANGLE_RED, TRIANGLE_BLUE, TRIANGLE_GREEN, TRIANGLE_OPACITY);
     
-    glUseProgram(g_program.programID);
+    g_program.Use();
     
     glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
     
@@ -175,7 +165,7 @@ void update()
 {
     
     
-    float ticks = (float) SDL_GetTicks() / MILLISECONDS_IN_SECOND; // get the current number of ticks
+    float ticks = (float) g_headless.get_ticks() / MILLISECONDS_IN_SECOND; // get the current number of ticks
     float delta_time = ticks - g_previous_ticks; // the delta time is the difference from the last frame
     g_previous_ticks = ticks;
 
@@ -272,11 +262,17 @@ void render() {
     SDL_GL_SwapWindow(g_display_window);
 }
 
-void shutdown() { SDL_Quit(); }
+void shutdown()
+{
+    g_resource_cache.cleanup();
+    g_headless.cleanup();
+    SDL_Quit();
+}
 
 
 int main(int argc, char* argv[])
 {
+    g_headless.parse_arguments(argc, argv);
     initialise();
     
     while (g_game_is_running)
@@ -284,6 +280,10 @@ int main(int argc, char* argv[])
         process_input();
         update();
         render();
+        
+        // Headless runs stop by themselves once they've drawn the frames they were asked for
+        g_headless.end_frame();
+        if (g_headless.is_finished()) g_game_is_running = false;
     }
     
     shutdown();
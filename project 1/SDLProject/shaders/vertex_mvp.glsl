@@ -0,0 +1,9 @@
+attribute vec4 position;
+
+// projectionMatrix * viewMatrix * modelMatrix, multiplied once on the CPU (see ShaderProgram)
+uniform mat4 modelViewProjectionMatrix;
+
+void main()
+{
+	gl_Position = modelViewProjectionMatrix * position;
+}
@@ -0,0 +1,13 @@
+attribute vec4 position;
+attribute vec2 texCoord;
+
+// projectionMatrix * viewMatrix * modelMatrix, multiplied once on the CPU (see ShaderProgram)
+uniform mat4 modelViewProjectionMatrix;
+
+varying vec2 texCoordVar;
+
+void main()
+{
+    texCoordVar = texCoord;
+	gl_Position = modelViewProjectionMatrix * position;
+}